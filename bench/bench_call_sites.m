@@ -0,0 +1,85 @@
+## Copyright (C) 2018-2018 Gene Harvey
+##
+## This file is part of Octave.
+##
+## Octave is free software: you can redistribute it and/or modify it
+## under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Octave is distributed in the hope that it will be useful, but
+## WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Octave; see the file COPYING.  If not, see
+## <https://www.gnu.org/licenses/>.
+
+## -*- texinfo -*-
+## @deftypefn  {} {@var{t} =} bench_call_sites ()
+## @deftypefnx {} {@var{t} =} bench_call_sites (@var{ncalls})
+## Time calls of validateattributes on a scalar from a user function.
+##
+## The builtin compiles the @var{classes} and @var{attributes} cells of a call
+## site that writes them as literals, so the overhead of a call is timed for
+## three functions that differ only in how the cells are written:
+##
+## @table @asis
+## @item @qcode{"literal"}
+## Cells of constants only, which are compiled once and reused as they are.
+##
+## @item @qcode{"named"}
+## Cells that also hold @code{NaN}, which are compiled once, and compared
+## with the compiled ones on every call.
+##
+## @item @qcode{"variable"}
+## Cells held in variables, which are parsed on every call.
+## @end table
+##
+## Each function is called @var{ncalls} times, default 1e5, and the time per
+## call in nanoseconds is printed and returned in the struct @var{t}.  With
+## the oct-file, which does not compile call sites, the three are about the
+## same.
+## @seealso{bench_validateattributes}
+## @end deftypefn
+
+function t = bench_call_sites (ncalls = 1e5)
+
+  srcs = struct (
+    "literal",  ['validateattributes (x, {"numeric"}, ' ...
+                 '{"positive", "integer", "<", 10, "size", [1 1]});'],
+    "named",    ['validateattributes (x, {"numeric"}, ' ...
+                 '{"positive", "integer", "<", 10, "size", [1 NaN]});'],
+    "variable", ['cls = {"numeric"}; ' ...
+                 'attr = {"positive", "integer", "<", 10, "size", [1 1]}; ' ...
+                 'validateattributes (x, cls, attr);']);
+
+  dir = tempname ();
+  mkdir (dir);
+  addpath (dir);
+  unwind_protect
+
+    t = struct ();
+    for [src, kind] = srcs
+      name = ["bench_call_site_" kind];
+      fid = fopen (fullfile (dir, [name ".m"]), "w");
+      fprintf (fid, "function %s (n)\n  x = 1;\n  for i = 1:n\n    %s\n  endfor\nendfunction\n",
+               name, src);
+      fclose (fid);
+
+      fcn = str2func (name);
+      fcn (1);  # warm up, and compile the call site
+      id = tic ();
+      fcn (ncalls);
+      t.(kind) = 1e9 * toc (id) / ncalls;
+      printf ("%-8s %10.1f ns/call\n", kind, t.(kind));
+    endfor
+
+  unwind_protect_cleanup
+    rmpath (dir);
+    confirm_recursive_rmdir (false, "local");
+    rmdir (dir, "s");
+  end_unwind_protect
+
+endfunction
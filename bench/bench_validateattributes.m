@@ -0,0 +1,361 @@
+## Copyright (C) 2018-2018 Gene Harvey
+##
+## This file is part of Octave.
+##
+## Octave is free software: you can redistribute it and/or modify it
+## under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Octave is distributed in the hope that it will be useful, but
+## WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Octave; see the file COPYING.  If not, see
+## <https://www.gnu.org/licenses/>.
+
+## -*- texinfo -*-
+## @deftypefn  {} {@var{results} =} bench_validateattributes ()
+## @deftypefnx {} {@var{results} =} bench_validateattributes (@var{property}, @var{value}, @dots{})
+## Benchmark the validateattributes oct-file against the reference m-file.
+##
+## Every attribute is timed for every combination of element class and size,
+## once with the oct-file and once with the @file{validateattributes.m}
+## shipped with Octave.  Only inputs that pass the reference are timed, so
+## both implementations do the full amount of work; a combination that the
+## reference rejects (for example @qcode{"increasing"} on a large
+## @code{int8} vector) is reported as skipped, and one where the two
+## implementations disagree is reported as a mismatch.
+##
+## The properties are:
+##
+## @table @asis
+## @item @qcode{"attributes"}
+## Cell array of attribute names.  Default is every attribute.
+##
+## @item @qcode{"classes"}
+## Cell array of element classes.  Besides the class names,
+## @qcode{"sparse"} and @qcode{"range"} select sparse double matrices and
+## ranges.  Default is all of them.
+##
+## @item @qcode{"sizes"}
+## Numbers of elements.  Default is @code{[1 1e2 1e4 1e6 1e8]}.
+##
+## @item @qcode{"mintime"}
+## Minimum time in seconds spent timing each implementation for each
+## combination.  Default is 0.1.
+##
+## @item @qcode{"reference"}
+## File name of the reference m-file.  Default is the
+## @file{validateattributes.m} found in the load path.
+##
+## @item @qcode{"output"}
+## File name of the tab-separated results.  Default is
+## @file{bench_output.txt}.  Use an empty string to not write a file.
+## @end table
+##
+## For each implementation the time per call, the throughput in GB/s of the
+## validated array, and the peak memory in bytes allocated by one call are
+## reported.  The peak memory is read from @file{/proc/self/status} and is
+## @code{NaN} where that is not available.
+##
+## The output file starts with comment lines, marked by @samp{#}, describing
+## the Octave version and host, followed by a header line and one line per
+## combination, which @code{textscan} or any spreadsheet can read.  The
+## same table is returned in the struct array @var{results}.
+## @seealso{validateattributes, validateattributes_stats}
+## @end deftypefn
+
+function results = bench_validateattributes (varargin)
+
+  all_attrs = {"2d", "3d", "column", "row", "real", "scalar", "square", ...
+               "size", "vector", "diag", "decreasing", "nonempty", ...
+               "nonsparse", "nonnan", "nonnegative", "nonzero", ...
+               "nondecreasing", "nonincreasing", "numel", "ncols", "nrows", ...
+               "ndims", "binary", "even", "odd", "integer", "increasing", ...
+               "finite", "positive", ">", ">=", "<", "<="};
+  all_classes = {"double", "single", "int8", "int16", "int32", "int64", ...
+                 "uint8", "uint16", "uint32", "uint64", "logical", "char", ...
+                 "sparse", "range"};
+
+  p = inputParser ();
+  p.FunctionName = "bench_validateattributes";
+  p.addParameter ("attributes", all_attrs, @iscellstr);
+  p.addParameter ("classes", all_classes, @iscellstr);
+  p.addParameter ("sizes", [1 1e2 1e4 1e6 1e8], @isnumeric);
+  p.addParameter ("mintime", 0.1, @isscalar);
+  p.addParameter ("reference", "", @ischar);
+  p.addParameter ("output", "bench_output.txt", @ischar);
+  p.parse (varargin{:});
+  opts = p.Results;
+
+  if (exist ("validateattributes") != 3)
+    error ("bench_validateattributes: validateattributes.oct is not in the load path");
+  endif
+
+  ref_dir = make_reference (opts.reference);
+  addpath (ref_dir);
+  unwind_protect
+
+    results = struct ("attribute", {}, "class", {}, "numel", {},
+                      "status", {}, "oct_time", {}, "ref_time", {},
+                      "speedup", {}, "oct_gbps", {}, "ref_gbps", {},
+                      "oct_peak", {}, "ref_peak", {});
+
+    for n = opts.sizes(:).'
+      for c = opts.classes
+        for a = opts.attributes
+          r = bench_one (a{1}, c{1}, n, opts.mintime);
+          results(end+1) = r;
+          printf ("%-14s %-8s %10d  %-8s", r.attribute, r.class, r.numel,
+                  r.status);
+          if (strcmp (r.status, "ok"))
+            printf ("  oct %10.3g s  ref %10.3g s  x%7.2f",
+                    r.oct_time, r.ref_time, r.speedup);
+          endif
+          printf ("\n");
+          fflush (stdout);
+        endfor
+      endfor
+    endfor
+
+  unwind_protect_cleanup
+    rmpath (ref_dir);
+    confirm_recursive_rmdir (false, "local");
+    rmdir (ref_dir, "s");
+  end_unwind_protect
+
+  if (! isempty (opts.output))
+    write_results (opts.output, results);
+  endif
+
+endfunction
+
+## Copy the reference m-file to a temporary directory under another name so
+## that it does not conflict with the oct-file.
+function ref_dir = make_reference (ref_file)
+
+  if (isempty (ref_file))
+    for d = strsplit (path (), pathsep ())
+      f = fullfile (d{1}, "validateattributes.m");
+      if (exist (f, "file"))
+        ref_file = f;
+        break;
+      endif
+    endfor
+    if (isempty (ref_file))
+      error ("bench_validateattributes: validateattributes.m not found, use the \"reference\" property");
+    endif
+  endif
+
+  src = fileread (ref_file);
+  src = regexprep (src, '(function\s+)validateattributes\s*\(',
+                   '$1validateattributes_ref (', "once");
+
+  ref_dir = tempname ();
+  mkdir (ref_dir);
+  fid = fopen (fullfile (ref_dir, "validateattributes_ref.m"), "w");
+  fputs (fid, src);
+  fclose (fid);
+
+endfunction
+
+function r = bench_one (attr, cls, n, mintime)
+
+  r = struct ("attribute", attr, "class", cls, "numel", n, "status", "skip",
+              "oct_time", NaN, "ref_time", NaN, "speedup", NaN,
+              "oct_gbps", NaN, "ref_gbps", NaN, "oct_peak", NaN,
+              "ref_peak", NaN);
+
+  [A, spec, ok] = make_input (attr, cls, n);
+  if (! ok)
+    return;
+  endif
+
+  classes = {};
+
+  try
+    validateattributes_ref (A, classes, spec);
+  catch
+    return;
+  end_try_catch
+
+  try
+    validateattributes (A, classes, spec);
+  catch err
+    r.status = "mismatch";
+    warning ("bench_validateattributes: %s on %s of %d elements: %s",
+             attr, cls, n, err.message);
+    return;
+  end_try_catch
+
+  info = whos ("A");
+  gbytes = info.bytes / 1e9;
+
+  r.status = "ok";
+  r.oct_time = time_calls (@() validateattributes (A, classes, spec), mintime);
+  r.ref_time = time_calls (@() validateattributes_ref (A, classes, spec),
+                           mintime);
+  r.speedup = r.ref_time / r.oct_time;
+  r.oct_gbps = gbytes / r.oct_time;
+  r.ref_gbps = gbytes / r.ref_time;
+  r.oct_peak = peak_bytes (@() validateattributes (A, classes, spec));
+  r.ref_peak = peak_bytes (@() validateattributes_ref (A, classes, spec));
+
+endfunction
+
+## Build an input of class CLS with about N elements that holds ATTR, and the
+## ATTRIBUTES cell to validate it with.  The reference decides whether the
+## combination is meaningful.
+function [A, spec, ok] = make_input (attr, cls, n)
+
+  ok = true;
+  spec = {attr};
+  m = max (1, round (sqrt (n)));
+  shape = [n 1];
+
+  switch (attr)
+    case {"increasing", "nondecreasing"}
+      x = (1:n).';
+    case {"decreasing", "nonincreasing"}
+      x = (n:-1:1).';
+    case "binary"
+      x = mod ((0:n-1).', 2);
+    case "even"
+      x = 2 * ones (n, 1);
+    case "odd"
+      x = ones (n, 1);
+    case "nonnegative"
+      x = mod ((0:n-1).', 100);
+    case "row"
+      x = 1 + mod ((0:n-1), 100);
+      shape = [1 n];
+    case "scalar"
+      ok = (n == 1);
+      x = 1;
+    case {"square", "diag"}
+      x = diag (1 + mod ((0:m-1).', 100));
+      shape = [m m];
+    otherwise
+      x = 1 + mod ((0:n-1).', 100);
+  endswitch
+
+  switch (attr)
+    case "size"
+      spec{2} = shape;
+    case "numel"
+      spec{2} = prod (shape);
+    case "ncols"
+      spec{2} = shape(2);
+    case "nrows"
+      spec{2} = shape(1);
+    case "ndims"
+      spec{2} = 2;
+    case ">"
+      spec{2} = 0;
+    case ">="
+      spec{2} = 0;
+    case "<"
+      spec{2} = max (x(:)) + 1;
+    case "<="
+      spec{2} = max (x(:));
+  endswitch
+
+  switch (cls)
+    case "sparse"
+      A = sparse (x);
+    case "range"
+      ## Ranges are rows, so shape attributes on columns are skipped.
+      step = unique (diff (x(:)));
+      if (isscalar (x))
+        A = x:x;
+      elseif (isscalar (step) && step != 0)
+        A = x(1):step:x(end);
+      else
+        ok = false;
+        A = [];
+      endif
+    case "logical"
+      A = logical (x);
+    otherwise
+      A = cast (x, cls);
+  endswitch
+
+endfunction
+
+## Time FCN, repeating it until at least MINTIME seconds have passed.
+function t = time_calls (fcn, mintime)
+
+  fcn ();  # warm up
+  reps = 1;
+  do
+    id = tic ();
+    for k = 1:reps
+      fcn ();
+    endfor
+    elapsed = toc (id);
+    if (elapsed < mintime)
+      reps *= max (2, ceil (mintime / max (elapsed, 1e-6) / 2));
+    endif
+  until (elapsed >= mintime)
+  t = elapsed / reps;
+
+endfunction
+
+## Peak resident memory, in bytes, added by one call of FCN.
+function bytes = peak_bytes (fcn)
+
+  bytes = NaN;
+  if (! exist ("/proc/self/clear_refs", "file"))
+    return;
+  endif
+
+  ## Writing 5 resets the high water mark VmHWM to the current VmRSS.
+  fid = fopen ("/proc/self/clear_refs", "w");
+  if (fid < 0)
+    return;
+  endif
+  fputs (fid, "5");
+  fclose (fid);
+
+  before = proc_status_kb ("VmRSS");
+  fcn ();
+  bytes = 1024 * max (0, proc_status_kb ("VmHWM") - before);
+
+endfunction
+
+function kb = proc_status_kb (field)
+
+  status = fileread ("/proc/self/status");
+  tok = regexp (status, [field ':\s*(\d+)'], "tokens", "once");
+  kb = str2double (tok{1});
+
+endfunction
+
+function write_results (file, results)
+
+  fid = fopen (file, "w");
+  if (fid < 0)
+    error ("bench_validateattributes: unable to open %s for writing", file);
+  endif
+
+  fprintf (fid, "# bench_validateattributes\n");
+  fprintf (fid, "# octave %s\n", version ());
+  fprintf (fid, "# host %s\n", gethostname ());
+  fprintf (fid, "# date %s\n", datestr (now (), 31));
+  fprintf (fid, "# oct-file %s\n", which ("validateattributes"));
+  fprintf (fid, "# times in seconds per call, peaks in bytes\n");
+
+  fields = fieldnames (results).';
+  fprintf (fid, "%s\n", strjoin (fields, "\t"));
+  for r = results
+    fprintf (fid, "%s\t%s\t%d\t%s\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\n",
+             r.attribute, r.class, r.numel, r.status, r.oct_time, r.ref_time,
+             r.speedup, r.oct_gbps, r.ref_gbps, r.oct_peak, r.ref_peak);
+  endfor
+
+  fclose (fid);
+
+endfunction
@@ -0,0 +1,313 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+// Microbenchmark of the validateattributes kernels on synthetic buffers,
+// without going through the interpreter.
+//
+// Usage: kernels_bench [--csv] [MAX_NUMEL]
+//
+// Every kernel is timed for sizes from 1 up to MAX_NUMEL (default 2^24), with
+// the violating element placed first, in the middle, last, or nowhere, so
+// that both the early exit and the full scan are measured.  The "dispatch"
+// rows time the name lookup and the switch over attribute codes on a scalar,
+// which is the fixed cost of every attribute.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../validateattributes-kernels.h"
+
+static volatile std::ptrdiff_t sink;
+
+static bool csv = false;
+
+enum position
+{
+  pos_first,
+  pos_middle,
+  pos_last,
+  pos_none
+};
+
+static const char *position_names[] = { "first", "middle", "last", "none" };
+
+static std::ptrdiff_t
+violation_index (position pos, std::ptrdiff_t n)
+{
+  switch (pos)
+    {
+      case pos_first:
+        return 0;
+      case pos_middle:
+        return n / 2;
+      case pos_last:
+        return n - 1;
+      default:
+        return -1;
+    }
+}
+
+// Time FCN, repeated until at least 20 ms have passed, in ns per call.
+template <typename F>
+static double
+time_ns (F fcn)
+{
+  typedef std::chrono::steady_clock clock;
+
+  fcn ();
+  for (long reps = 1; ; reps *= 2)
+    {
+      clock::time_point t0 = clock::now ();
+      for (long k = 0; k < reps; k++)
+        sink = fcn ();
+      double ns = std::chrono::duration<double, std::nano>
+                    (clock::now () - t0).count ();
+      if (ns >= 2e7)
+        return ns / reps;
+    }
+}
+
+static void
+report (const char *kernel, const char *type, std::ptrdiff_t n,
+        const char *pos, double ns)
+{
+  if (csv)
+    std::printf ("%s,%s,%td,%s,%.3f,%.5f\n", kernel, type, n, pos, ns,
+                 ns / (n > 0 ? n : 1));
+  else
+    std::printf ("%-15s %-11s %10td %-7s %14.1f ns %10.4f ns/elem\n",
+                 kernel, type, n, pos, ns, ns / (n > 0 ? n : 1));
+}
+
+// Value kernels through scan_attr on a buffer of N elements of type T which
+// hold CODE except at one position.
+template <typename T>
+static void
+bench_values (const char *type, attr_code code, std::ptrdiff_t n,
+              double bound, T good, T bad, bool ramp)
+{
+  std::vector<T> x (n);
+
+  for (int p = pos_first; p <= pos_none; p++)
+    {
+      for (std::ptrdiff_t i = 0; i < n; i++)
+        x[i] = (ramp ? static_cast<T> (i % 100 + 1) : good);
+
+      std::ptrdiff_t k = violation_index (static_cast<position> (p), n);
+      if (k >= 0)
+        x[k] = bad;
+
+      const T *data = x.data ();
+      double ns = time_ns ([=] ()
+                           { return scan_attr (code, data, n, 1, bound); });
+      report (attr_table[code].name, type, n, position_names[p], ns);
+    }
+}
+
+template <typename T>
+static void
+bench_monotone (const char *type, std::ptrdiff_t n)
+{
+  std::vector<T> x (n);
+
+  for (int p = pos_first; p <= pos_none; p++)
+    {
+      for (std::ptrdiff_t i = 0; i < n; i++)
+        x[i] = static_cast<T> (i);
+
+      // an element equal to its predecessor breaks "increasing"
+      std::ptrdiff_t k = violation_index (static_cast<position> (p), n);
+      if (k > 0)
+        x[k] = x[k-1];
+      else if (k == 0 && n > 1)
+        x[1] = x[0];
+
+      const T *data = x.data ();
+      double ns = time_ns ([=] ()
+                           { return scan_attr (attr_increasing, data, n, 1,
+                                               0); });
+      report ("increasing", type, n, position_names[p], ns);
+    }
+}
+
+static void
+bench_diag (std::ptrdiff_t n)
+{
+  std::ptrdiff_t m = 1;
+  while ((m + 1) * (m + 1) <= n)
+    m++;
+
+  std::vector<double> x (m * m);
+
+  for (int p = pos_first; p <= pos_none; p++)
+    {
+      std::fill (x.begin (), x.end (), 0.0);
+      for (std::ptrdiff_t i = 0; i < m; i++)
+        x[i*m + i] = 1.0;
+
+      // off-diagonal nonzero in the first, middle or last column
+      std::ptrdiff_t k = violation_index (static_cast<position> (p), m);
+      if (k >= 0 && m > 1)
+        x[k*m + (k == 0 ? 1 : 0)] = 1.0;
+
+      const double *data = x.data ();
+      double ns = time_ns ([=] ()
+                           { return scan_attr (attr_diag, data, m, m, 0); });
+      report ("diag", "double", m * m, position_names[p], ns);
+    }
+}
+
+static void
+bench_size ()
+{
+  std::vector<std::ptrdiff_t> dims = { 4, 6, 7, 2 };
+  auto dv = [&dims] (int i) { return dims[i]; };
+
+  for (int p = pos_first; p <= pos_none; p++)
+    {
+      std::vector<double> pat = { 4, 6, 7, 2 };
+      std::ptrdiff_t k = violation_index (static_cast<position> (p), 4);
+      if (k >= 0)
+        pat[k] = 5;
+      pat[1] = std::numeric_limits<double>::quiet_NaN ();
+
+      size_pattern sp = size_pattern_from (pat.data (), 4);
+      double ns = time_ns ([&] () { return match_size (dv, 4, sp); });
+      report ("size", "dims", 4, position_names[p], ns);
+    }
+}
+
+static void
+bench_dispatch ()
+{
+  static const char *names[] = { "2d", "size", "nonnan", "nonnegative",
+                                  "increasing", "<=" };
+
+  for (const char *name : names)
+    {
+      std::string s (name);
+      double ns = time_ns ([&s] () { return attr_lookup (s); });
+      report ("lookup", name, 1, "-", ns);
+    }
+
+  double one = 1.0;
+  const double *x = &one;
+  double ns = time_ns ([=] () { return scan_attr (attr_positive, x, 1, 1, 0); });
+  report ("dispatch", "double", 1, "none", ns);
+  ns = time_ns ([=] () { return scan_first (x, 1, viol_positive ()); });
+  report ("direct", "double", 1, "none", ns);
+}
+
+// Four attributes on the same passing buffer, each in its own sweep and
+// all in one through scan_fused.
+static void
+bench_fused (std::ptrdiff_t n)
+{
+  static const attr_code codes[] = { attr_nonnan, attr_finite, attr_positive,
+                                     attr_integer };
+  static const double bounds[] = { 0, 0, 0, 0 };
+
+  std::vector<double> x (n);
+  for (std::ptrdiff_t i = 0; i < n; i++)
+    x[i] = i % 100 + 1;
+
+  const double *data = x.data ();
+
+  double ns = time_ns ([=] ()
+                       {
+                         std::ptrdiff_t r = 0;
+                         for (attr_code code : codes)
+                           r += scan_attr (code, data, n, 1, 0);
+                         return r;
+                       });
+  report ("4 separate", "double", n, "none", ns);
+
+  ns = time_ns ([=] ()
+                {
+                  std::ptrdiff_t idx[4];
+                  scan_fused (codes, bounds, 4, data, n, 1, idx);
+                  return idx[0];
+                });
+  report ("4 fused", "double", n, "none", ns);
+
+  ns = time_ns ([=] ()
+                {
+                  std::ptrdiff_t idx[4];
+                  value_summary<double> sum;
+                  scan_fused (codes, bounds, 4, data, n, 1, idx, true, &sum);
+                  return sum.nzero;
+                });
+  report ("4 fused+summary", "double", n, "none", ns);
+}
+
+int
+main (int argc, char **argv)
+{
+  std::ptrdiff_t max_numel = std::ptrdiff_t (1) << 24;
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (! std::strcmp (argv[i], "--csv"))
+        csv = true;
+      else
+        max_numel = std::atol (argv[i]);
+    }
+
+  if (csv)
+    std::printf ("kernel,type,numel,violation,ns_per_call,ns_per_elem\n");
+
+  const double nan = std::numeric_limits<double>::quiet_NaN ();
+  const float nanf = std::numeric_limits<float>::quiet_NaN ();
+
+  bench_dispatch ();
+  bench_size ();
+
+  for (std::ptrdiff_t n = 1; n <= max_numel; n *= 8)
+    {
+      bench_values<double> ("double", attr_nonnan, n, 0, 1.0, nan, false);
+      bench_values<float> ("single", attr_nonnan, n, 0, 1.0f, nanf, false);
+      bench_values<double> ("double", attr_finite, n, 0, 1.0, nan, false);
+      bench_values<double> ("double", attr_positive, n, 0, 1.0, 0.0, true);
+      bench_values<int32_t> ("int32", attr_positive, n, 0, 1, 0, true);
+      bench_values<double> ("double", attr_integer, n, 0, 1.0, 0.5, true);
+      bench_values<double> ("double", attr_gt, n, 0, 1.0, -1.0, true);
+      bench_values<float> ("single", attr_gt, n, 0, 1.0f, -1.0f, true);
+      bench_values<int64_t> ("int64", attr_gt, n, 0, 1, -1, true);
+      bench_values<uint8_t> ("uint8", attr_le, n, 100, 1, 200, true);
+      bench_values<double> ("double", attr_castable, n, cast_int32, 1.0, 0.5,
+                            true);
+      bench_values<double> ("double", attr_castable, n, cast_single, 1.0, 0.1,
+                            true);
+      bench_monotone<double> ("double", n);
+      bench_monotone<int32_t> ("int32", n);
+      bench_diag (n);
+      bench_fused (n);
+    }
+
+  return 0;
+}
@@ -0,0 +1,1681 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+// The parts of validateattributes that do not depend on Octave: the
+// attribute codes and the kernels that scan the elements of an array.  They
+// work on plain column-major buffers so that they can also be benchmarked on
+// their own, see bench/kernels_bench.cc.
+//
+// Kernels return the linear index of the first element that violates the
+// attribute, or -1 if there is none.
+
+#if ! defined (validateattributes_kernels_h)
+#define validateattributes_kernels_h 1
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static inline bool
+attr_strcmpi (const std::string& name, const char *ref)
+{
+  std::size_t i;
+
+  for (i = 0; i < name.length (); i++)
+    {
+      if (ref[i] == '\0'
+          || std::tolower (static_cast<unsigned char> (name[i])) != ref[i])
+        return false;
+    }
+  return ref[i] == '\0';
+}
+
+enum attr_code
+{
+  attr_2d,
+  attr_3d,
+  attr_column,
+  attr_row,
+  attr_real,
+  attr_scalar,
+  attr_square,
+  attr_size,
+  attr_vector,
+  attr_diag,
+  attr_decreasing,
+  attr_nonempty,
+  attr_nonsparse,
+  attr_nonnan,
+  attr_nonnegative,
+  attr_nonzero,
+  attr_nondecreasing,
+  attr_nonincreasing,
+  attr_numel,
+  attr_ncols,
+  attr_nrows,
+  attr_ndims,
+  attr_binary,
+  attr_even,
+  attr_odd,
+  attr_integer,
+  attr_increasing,
+  attr_finite,
+  attr_positive,
+  attr_gt,
+  attr_ge,
+  attr_lt,
+  attr_le,
+  attr_realvalued,
+  attr_maxnnz,
+  attr_maxcolnnz,
+  attr_nostoredzeros,
+  attr_sortedindices,
+  attr_sizeas,
+  attr_classas,
+  attr_castable,
+  attr_sample,
+  attr_async,
+  attr_collect,
+  attr_explain,
+  attr_locate,
+  attr_num_codes,
+  attr_unknown = attr_num_codes
+};
+
+enum attr_kind
+{
+  kind_shape,    // looks at the class and dimensions of A only
+  kind_value,    // inspects the values of A
+  kind_pattern,  // looks at which elements of A are stored or nonzero
+  kind_ref,      // compares A with another argument of the same call
+  kind_option    // changes how the other attributes are checked
+};
+
+struct attr_desc
+{
+  const char *name;
+  bool        has_value; // takes the next element of ATTRIBUTES
+  attr_kind   kind;
+};
+
+// indexed by attr_code
+static const attr_desc attr_table[attr_num_codes] =
+{
+  { "2d",            false, kind_shape   },
+  { "3d",            false, kind_shape   },
+  { "column",        false, kind_shape   },
+  { "row",           false, kind_shape   },
+  { "real",          false, kind_shape   },
+  { "scalar",        false, kind_shape   },
+  { "square",        false, kind_shape   },
+  { "size",          true,  kind_shape   },
+  { "vector",        false, kind_shape   },
+  { "diag",          false, kind_value   },
+  { "decreasing",    false, kind_value   },
+  { "nonempty",      false, kind_shape   },
+  { "nonsparse",     false, kind_shape   },
+  { "nonnan",        false, kind_value   },
+  { "nonnegative",   false, kind_value   },
+  { "nonzero",       false, kind_value   },
+  { "nondecreasing", false, kind_value   },
+  { "nonincreasing", false, kind_value   },
+  { "numel",         true,  kind_shape   },
+  { "ncols",         true,  kind_shape   },
+  { "nrows",         true,  kind_shape   },
+  { "ndims",         true,  kind_shape   },
+  { "binary",        false, kind_value   },
+  { "even",          false, kind_value   },
+  { "odd",           false, kind_value   },
+  { "integer",       false, kind_value   },
+  { "increasing",    false, kind_value   },
+  { "finite",        false, kind_value   },
+  { "positive",      false, kind_value   },
+  { ">",             true,  kind_value   },
+  { ">=",            true,  kind_value   },
+  { "<",             true,  kind_value   },
+  { "<=",            true,  kind_value   },
+  { "realvalued",    false, kind_value   },
+  { "maxnnz",        true,  kind_pattern },
+  { "maxcolnnz",     true,  kind_pattern },
+  { "nostoredzeros", false, kind_pattern },
+  { "sortedindices", false, kind_pattern },
+  { "sizeas",        true,  kind_ref     },
+  { "classas",       true,  kind_ref     },
+  { "castable",      true,  kind_value   },
+  { "sample",        true,  kind_option  },
+  { "async",         false, kind_option  },
+  { "collect",       false, kind_option  },
+  { "explain",       false, kind_option  },
+  { "locate",        true,  kind_option  },
+};
+
+inline attr_code
+attr_lookup (const std::string& name)
+{
+  size_t len = name.length ();
+
+  if (len < 1)
+    return attr_unknown;
+
+  switch (std::tolower (name[0]))
+    {
+      case '2': // 2d
+        if (len == 2 && std::tolower (name[1]) == 'd')
+          return attr_2d;
+        break;
+      case '3': // 3d
+        if (len == 2 && std::tolower (name[1]) == 'd')
+          return attr_3d;
+        break;
+      case 'c': // column, collect, classas, castable
+        if (attr_strcmpi (name, "column"))
+          return attr_column;
+        else if (attr_strcmpi (name, "collect"))
+          return attr_collect;
+        else if (attr_strcmpi (name, "classas"))
+          return attr_classas;
+        else if (attr_strcmpi (name, "castable"))
+          return attr_castable;
+        break;
+      case 'r': // row, real, realvalued
+        if (attr_strcmpi (name, "row"))
+          return attr_row;
+        else if (attr_strcmpi (name, "real"))
+          return attr_real;
+        else if (attr_strcmpi (name, "realvalued"))
+          return attr_realvalued;
+        break;
+      case 's': // scalar, square, size, sample, sortedindices, sizeas
+        if (attr_strcmpi (name, "scalar"))
+          return attr_scalar;
+        else if (attr_strcmpi (name, "square"))
+          return attr_square;
+        else if (attr_strcmpi (name, "size"))
+          return attr_size;
+        else if (attr_strcmpi (name, "sample"))
+          return attr_sample;
+        else if (attr_strcmpi (name, "sortedindices"))
+          return attr_sortedindices;
+        else if (attr_strcmpi (name, "sizeas"))
+          return attr_sizeas;
+        break;
+      case 'v': // vector
+        if (attr_strcmpi (name, "vector"))
+          return attr_vector;
+        break;
+      case 'd': // diag, decreasing
+        if (attr_strcmpi (name, "diag"))
+          return attr_diag;
+        else if (attr_strcmpi (name, "decreasing"))
+          return attr_decreasing;
+        break;
+      case 'n': // nonempty, nonsparse, nonnan, nonnegative, nonzero,
+        // nondecreasing, nonincreasing, nostoredzeros, numel, ncols, nrows,
+        // ndims
+        {
+          if (len < 2)
+            break;
+
+          switch (std::tolower (name[1]))
+            {
+              case 'o': // nonempty, nonsparse, nonnan, nonnegative,
+                // nonzero, nondecreasing, nonincreasing, nostoredzeros
+                {
+                  if (len < 4)
+                    break;
+                  else if (std::tolower (name[2]) == 's')
+                    {
+                      if (attr_strcmpi (name, "nostoredzeros"))
+                        return attr_nostoredzeros;
+                      break;
+                    }
+
+                  switch (std::tolower (name[3]))
+                    {
+                      case 'e': // nonempty
+                        if (attr_strcmpi (name, "nonempty"))
+                          return attr_nonempty;
+                        break;
+                      case 's': // nonsparse
+                        if (attr_strcmpi (name, "nonsparse"))
+                          return attr_nonsparse;
+                        break;
+                      case 'n': // nonnan, nonnegative
+                        if (attr_strcmpi (name, "nonnan"))
+                          return attr_nonnan;
+                        else if (attr_strcmpi (name, "nonnegative"))
+                          return attr_nonnegative;
+                        break;
+                      case 'z': // nonzero
+                        if (attr_strcmpi (name, "nonzero"))
+                          return attr_nonzero;
+                        break;
+                      case 'd': // nondecreasing
+                        if (attr_strcmpi (name, "nondecreasing"))
+                          return attr_nondecreasing;
+                        break;
+                      case 'i': // nonincreasing
+                        if (attr_strcmpi (name, "nonincreasing"))
+                          return attr_nonincreasing;
+                        break;
+                    }
+                  break;
+                }
+              case 'u': // numel
+                if (attr_strcmpi (name, "numel"))
+                  return attr_numel;
+                break;
+              case 'c': // ncols
+                if (attr_strcmpi (name, "ncols"))
+                  return attr_ncols;
+                break;
+              case 'r': // nrows
+                if (attr_strcmpi (name, "nrows"))
+                  return attr_nrows;
+                break;
+              case 'd': // ndims
+                if (attr_strcmpi (name, "ndims"))
+                  return attr_ndims;
+                break;
+            }
+          break;
+        }
+      case 'b': // binary
+        if (attr_strcmpi (name, "binary"))
+          return attr_binary;
+        break;
+      case 'e': // even, explain
+        if (attr_strcmpi (name, "even"))
+          return attr_even;
+        else if (attr_strcmpi (name, "explain"))
+          return attr_explain;
+        break;
+      case 'o': // odd
+        if (attr_strcmpi (name, "odd"))
+          return attr_odd;
+        break;
+      case 'i': // integer, increasing
+        if (attr_strcmpi (name, "integer"))
+          return attr_integer;
+        else if (attr_strcmpi (name, "increasing"))
+          return attr_increasing;
+        break;
+      case 'f': // finite
+        if (attr_strcmpi (name, "finite"))
+          return attr_finite;
+        break;
+      case 'p': // positive
+        if (attr_strcmpi (name, "positive"))
+          return attr_positive;
+        break;
+      case 'm': // maxnnz, maxcolnnz
+        if (attr_strcmpi (name, "maxnnz"))
+          return attr_maxnnz;
+        else if (attr_strcmpi (name, "maxcolnnz"))
+          return attr_maxcolnnz;
+        break;
+      case 'a': // async
+        if (attr_strcmpi (name, "async"))
+          return attr_async;
+        break;
+      case 'l': // locate
+        if (attr_strcmpi (name, "locate"))
+          return attr_locate;
+        break;
+      case '>': // >, >=
+        if (len == 1)
+          return attr_gt;
+        else if (len == 2 && name[1] == '=')
+          return attr_ge;
+        break;
+      case '<': // <, <=
+        if (len == 1)
+          return attr_lt;
+        else if (len == 2 && name[1] == '=')
+          return attr_le;
+        break;
+    }
+  return attr_unknown;
+}
+
+// The classes named by the value of "castable".  The kernels take it as
+// their bound.
+enum cast_class
+{
+  cast_double,
+  cast_single,
+  cast_int8,
+  cast_uint8,
+  cast_int16,
+  cast_uint16,
+  cast_int32,
+  cast_uint32,
+  cast_int64,
+  cast_uint64,
+  cast_logical,
+  cast_unknown
+};
+
+static const char *cast_class_names[cast_unknown] =
+{
+  "double", "single", "int8", "uint8", "int16", "uint16", "int32", "uint32",
+  "int64", "uint64", "logical"
+};
+
+inline cast_class
+cast_lookup (const std::string& name)
+{
+  int c = 0;
+  while (c < cast_unknown && name != cast_class_names[c])
+    c++;
+  return static_cast<cast_class> (c);
+}
+
+template <typename T>
+struct is_complex : std::false_type { };
+
+template <typename T>
+struct is_complex<std::complex<T>> : std::true_type { };
+
+// Octave orders complex values by their absolute value, and those of equal
+// absolute value by their argument in (-pi, pi].  A real operand is the
+// complex value with a zero imaginary part.
+
+template <typename T>
+inline T
+cmplx_arg (const std::complex<T>& z)
+{
+  static const T pi = static_cast<T> (3.14159265358979323846);
+
+  T a = std::arg (z);
+  return (a == -pi ? pi : a);
+}
+
+template <typename T, typename O>
+inline bool
+cmplx_cmp (const std::complex<T>& a, const std::complex<T>& b, O op)
+{
+  T ax = std::abs (a);
+  T bx = std::abs (b);
+
+  if (ax == bx)
+    return op (cmplx_arg (a), cmplx_arg (b));
+  else
+    return op (ax, bx);
+}
+
+// Violation predicates for the element-wise attributes.  Comparisons follow
+// Octave: a NaN is neither positive nor negative, and is not equal to
+// anything.  A complex value is NaN if either part is.
+
+struct viol_nan
+{
+  template <typename T>
+  bool operator () (T x) const { return x != x; }
+};
+
+struct viol_finite
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (is_complex<T>::value)
+      return (*this) (x.real ()) || (*this) (x.imag ());
+    else if constexpr (std::is_floating_point<T>::value)
+      return ! (std::abs (x) <= std::numeric_limits<T>::max ());
+    else
+      return false;
+  }
+};
+
+struct viol_nonnegative
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (is_complex<T>::value)
+      return cmplx_cmp (x, T (0), std::less<> ());
+    else
+      return x < T (0);
+  }
+};
+
+struct viol_nonzero
+{
+  template <typename T>
+  bool operator () (T x) const { return x == T (0); }
+};
+
+struct viol_positive
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (is_complex<T>::value)
+      return cmplx_cmp (x, T (0), std::less_equal<> ());
+    else
+      return x <= T (0);
+  }
+};
+
+// Complex storage with a nonzero imaginary part.
+struct viol_imag
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (is_complex<T>::value)
+      return x.imag () != 0;
+    else
+      return false;
+  }
+};
+
+struct viol_binary
+{
+  template <typename T>
+  bool operator () (T x) const { return x != T (0) && x != T (1); }
+};
+
+struct viol_integer
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (std::is_floating_point<T>::value)
+      return std::ceil (x) != x;
+    else
+      return false;
+  }
+};
+
+// rem (x, 2) == 0
+struct viol_even
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (std::is_floating_point<T>::value)
+      return std::fmod (x, T (2)) != 0;
+    else
+      return (x % 2) != 0;
+  }
+};
+
+// mod (x, 2) == 1
+struct viol_odd
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (std::is_floating_point<T>::value)
+      {
+        T m = std::fmod (x, T (2));
+        return m != 1 && m != -1;
+      }
+    else
+      return (x % 2) == 0;
+  }
+};
+
+// 2^K, exactly.
+constexpr double
+pow2 (int k)
+{
+  double r = 1;
+  for (int i = 0; i < k; i++)
+    r *= 2;
+  return r;
+}
+
+// x does not convert to D, the element type of the class named by
+// "castable", without saturating, rounding, or turning NaN into zero.  For
+// a complex value both parts must convert, and for a target class that is
+// not floating point the imaginary part must be zero.  Integers are
+// compared in their own types, and floating point values against the range
+// of D, which is exact as its ends are powers of 2.
+template <typename D>
+struct viol_cast
+{
+  template <typename T>
+  bool operator () (T x) const
+  {
+    if constexpr (is_complex<T>::value)
+      {
+        if constexpr (std::is_floating_point<D>::value)
+          return (*this) (x.real ()) || (*this) (x.imag ());
+        else
+          return x.imag () != 0 || (*this) (x.real ());
+      }
+    else if constexpr (std::is_same<T, bool>::value)
+      return false;
+    else if constexpr (std::is_same<D, bool>::value)
+      return x != T (0) && x != T (1);
+    else if constexpr (std::is_floating_point<D>::value
+                       && std::is_floating_point<T>::value)
+      {
+        if constexpr (sizeof (D) >= sizeof (T))
+          return false;
+        else
+          {
+            // casting a finite value beyond the range of D is undefined
+            T a = std::abs (x);
+            return (a <= std::numeric_limits<T>::max ()
+                    && ! (a <= std::numeric_limits<D>::max ()
+                          && T (D (x)) == x));
+          }
+      }
+    else if constexpr (std::is_floating_point<D>::value)
+      {
+        if constexpr (std::numeric_limits<T>::digits
+                      <= std::numeric_limits<D>::digits)
+          return false;
+        else
+          {
+            // D (x) may round up to 2^digits, just outside of T
+            constexpr D end = D (pow2 (std::numeric_limits<T>::digits));
+            D d = D (x);
+            return d >= end || T (d) != x;
+          }
+      }
+    else if constexpr (std::is_floating_point<T>::value)
+      {
+        constexpr T hi = T (pow2 (std::numeric_limits<D>::digits));
+        constexpr T lo = (std::is_signed<D>::value ? -hi : T (0));
+        return ! (x >= lo && x < hi && std::trunc (x) == x);
+      }
+    else if constexpr (std::is_signed<T>::value == std::is_signed<D>::value)
+      return (x < std::numeric_limits<D>::min ()
+              || x > std::numeric_limits<D>::max ());
+    else if constexpr (std::is_signed<T>::value)
+      return (x < 0 || static_cast<std::make_unsigned_t<T>> (x)
+                       > std::numeric_limits<D>::max ());
+    else
+      return (x > static_cast<std::make_unsigned_t<D>> (
+                    std::numeric_limits<D>::max ()));
+  }
+};
+
+static const std::ptrdiff_t scan_block = 256;
+
+// Index of the first x(i) for which VIOL is true.  Blocks are reduced
+// without branches so the compiler can vectorize them, and only the block
+// holding the first violation is scanned element by element.
+template <typename T, typename P>
+inline std::ptrdiff_t
+scan_first (const T *x, std::ptrdiff_t n, P viol)
+{
+  std::ptrdiff_t i = 0;
+
+  for (; i + scan_block <= n; i += scan_block)
+    {
+      bool hit = false;
+      for (std::ptrdiff_t k = 0; k < scan_block; k++)
+        hit |= viol (x[i+k]);
+      if (hit)
+        break;
+    }
+
+  for (; i < n; i++)
+    {
+      if (viol (x[i]))
+        return i;
+    }
+  return -1;
+}
+
+// "castable" to the class TO, a cast_class.
+template <typename T>
+inline std::ptrdiff_t
+scan_castable (const T *x, std::ptrdiff_t n, double to)
+{
+  switch (static_cast<cast_class> (to))
+    {
+      case cast_double:
+        return scan_first (x, n, viol_cast<double> ());
+      case cast_single:
+        return scan_first (x, n, viol_cast<float> ());
+      case cast_int8:
+        return scan_first (x, n, viol_cast<int8_t> ());
+      case cast_uint8:
+        return scan_first (x, n, viol_cast<uint8_t> ());
+      case cast_int16:
+        return scan_first (x, n, viol_cast<int16_t> ());
+      case cast_uint16:
+        return scan_first (x, n, viol_cast<uint16_t> ());
+      case cast_int32:
+        return scan_first (x, n, viol_cast<int32_t> ());
+      case cast_uint32:
+        return scan_first (x, n, viol_cast<uint32_t> ());
+      case cast_int64:
+        return scan_first (x, n, viol_cast<int64_t> ());
+      case cast_uint64:
+        return scan_first (x, n, viol_cast<uint64_t> ());
+      case cast_logical:
+        return scan_first (x, n, viol_cast<bool> ());
+      default:
+        return -1;
+    }
+}
+
+// Index of the first element which is NaN or breaks x(i) OP x(i-1).
+template <typename T, typename O>
+inline std::ptrdiff_t
+scan_monotone (const T *x, std::ptrdiff_t n, O op)
+{
+  if (n > 0 && x[0] != x[0])
+    return 0;
+
+  for (std::ptrdiff_t i = 1; i < n; i++)
+    {
+      if (! op (x[i], x[i-1]))
+        return i;
+    }
+  return -1;
+}
+
+// Index of the first nonzero element off the diagonal of an NR-by-NC matrix.
+template <typename T>
+inline std::ptrdiff_t
+scan_diag (const T *x, std::ptrdiff_t nr, std::ptrdiff_t nc)
+{
+  for (std::ptrdiff_t j = 0; j < nc; j++)
+    {
+      const T *col = x + j*nr;
+      for (std::ptrdiff_t i = 0; i < nr; i++)
+        {
+          if (i != j && col[i] != T (0))
+            return j*nr + i;
+        }
+    }
+  return -1;
+}
+
+// Comparison of every element against a bound.  Floating point elements are
+// compared as double, which is exact.  For integer elements the bound is
+// rounded once to the type so that the comparison stays exact for 64-bit
+// integers, and a bound outside the range of the type decides the result for
+// every element.
+
+enum bound_range
+{
+  bound_below,
+  bound_inside,
+  bound_above
+};
+
+template <typename T>
+inline bound_range
+int_bound (double v, bool round_up, T& t)
+{
+  // 2^digits is one past the largest value of T, and exactly representable
+  const double above = std::ldexp (1.0, std::numeric_limits<T>::digits);
+  const double lowest = std::numeric_limits<T>::lowest ();
+
+  double r = (round_up ? std::ceil (v) : std::floor (v));
+
+  if (r >= above)
+    return bound_above;
+  else if (r < lowest)
+    return bound_below;
+
+  t = static_cast<T> (r);
+  return bound_inside;
+}
+
+// V rounded down or up to the floating point type T, so that comparing a
+// value of T with the result, in T, gives the same as comparing it with V in
+// double, see bound_traits.  For double this is V itself.
+template <typename T>
+inline T
+float_bound (double v, bool round_up)
+{
+  const double max = std::numeric_limits<T>::max ();
+  const T      inf = std::numeric_limits<T>::infinity ();
+
+  if (v != v || std::isinf (v))
+    return static_cast<T> (v);
+  else if (v > max)
+    return (round_up ? inf : std::numeric_limits<T>::max ());
+  else if (v < -max)
+    return (round_up ? std::numeric_limits<T>::lowest () : -inf);
+
+  T t = static_cast<T> (v);
+
+  if (round_up && static_cast<double> (t) < v)
+    t = std::nextafter (t, inf);
+  else if (! round_up && static_cast<double> (t) > v)
+    t = std::nextafter (t, -inf);
+
+  return t;
+}
+
+// How a comparison against a double bound is done for an integer or single
+// x: x > v is x > floor (v), x >= v is x >= ceil (v), x < v is x < ceil (v),
+// and x <= v is x <= floor (v), each rounded to the type of x.  PASS_ABOVE
+// tells whether a bound above the range of an integer type is satisfied by
+// every element.
+template <typename O>
+struct bound_traits;
+
+template <>
+struct bound_traits<std::greater<>>
+{
+  static const bool round_up = false;
+  static const bool pass_above = false;
+};
+
+template <>
+struct bound_traits<std::greater_equal<>>
+{
+  static const bool round_up = true;
+  static const bool pass_above = false;
+};
+
+template <>
+struct bound_traits<std::less<>>
+{
+  static const bool round_up = true;
+  static const bool pass_above = true;
+};
+
+template <>
+struct bound_traits<std::less_equal<>>
+{
+  static const bool round_up = false;
+  static const bool pass_above = true;
+};
+
+template <typename T, typename O>
+inline std::ptrdiff_t
+scan_compare (const T *x, std::ptrdiff_t n, O op, double v)
+{
+  if constexpr (is_complex<T>::value)
+    {
+      const std::complex<double> cv (v);
+      return scan_first (x, n, [op, cv] (T xi)
+                         {
+                           return ! cmplx_cmp (std::complex<double> (xi), cv,
+                                               op);
+                         });
+    }
+  else if constexpr (std::is_floating_point<T>::value)
+    {
+      // single values are compared as such, against the bound rounded once
+      const T t = float_bound<T> (v, bound_traits<O>::round_up);
+      return scan_first (x, n, [op, t] (T xi) { return ! op (xi, t); });
+    }
+  else
+    {
+      T t = T ();
+      bool pass;
+
+      if (v != v)
+        pass = false;
+      else
+        {
+          switch (int_bound<T> (v, bound_traits<O>::round_up, t))
+            {
+              case bound_inside:
+                return scan_first (x, n, [op, t] (T xi)
+                                   { return ! op (xi, t); });
+              case bound_above:
+                pass = bound_traits<O>::pass_above;
+                break;
+              default:
+                pass = ! bound_traits<O>::pass_above;
+            }
+        }
+
+      return (pass || n == 0) ? -1 : 0;
+    }
+}
+
+// Comparison against an operand BOUND broadcast to the NDIMS dimensions DIMS
+// of the array: each of its dimensions BDIMS is either 1 or the same as in
+// DIMS.
+
+// Linear index into BOUND of the bound for element IDX of the array.
+inline std::ptrdiff_t
+bcast_index (const std::ptrdiff_t *dims, const std::ptrdiff_t *bdims,
+             int ndims, std::ptrdiff_t idx)
+{
+  std::ptrdiff_t bidx = 0;
+  std::ptrdiff_t bstride = 1;
+
+  for (int k = 0; k < ndims; k++)
+    {
+      std::ptrdiff_t sub = idx % dims[k];
+      idx /= dims[k];
+      if (bdims[k] != 1)
+        bidx += sub * bstride;
+      bstride *= bdims[k];
+    }
+  return bidx;
+}
+
+// Columns that share one bound are scanned with scan_compare, so that the
+// bound is only converted once per column.
+template <typename T, typename O>
+inline std::ptrdiff_t
+scan_compare_bcast (const T *x, const std::ptrdiff_t *dims, int ndims, O op,
+                    const double *bound, const std::ptrdiff_t *bdims)
+{
+  std::ptrdiff_t n = 1;
+  for (int k = 0; k < ndims; k++)
+    n *= dims[k];
+
+  std::ptrdiff_t nr = dims[0];
+
+  for (std::ptrdiff_t j = 0; j < n; j += nr)
+    {
+      const double *b = bound + bcast_index (dims, bdims, ndims, j);
+
+      if (bdims[0] == 1)
+        {
+          std::ptrdiff_t r = scan_compare (x + j, nr, op, b[0]);
+          if (r >= 0)
+            return j + r;
+        }
+      else
+        {
+          for (std::ptrdiff_t i = 0; i < nr; i++)
+            {
+              if (scan_compare (x + j + i, 1, op, b[i]) >= 0)
+                return j + i;
+            }
+        }
+    }
+  return -1;
+}
+
+// Pattern of the "size" attribute, parsed once.  Each dimension has a
+// range of lengths, which is a single length or any length for the plain
+// numeric patterns, and can be tied to the length of another dimension.
+
+struct dim_rule
+{
+  double lo;   // shortest length allowed
+  double hi;   // longest length allowed
+  int    tie;  // dimension whose length it must have, or -1
+};
+
+struct size_pattern
+{
+  std::vector<dim_rule> rules;
+
+  // whether any number of dimensions, of any length, may follow the rules
+  bool trailing = false;
+
+  // whether rules past the dimensions of the array apply to lengths of 1,
+  // otherwise those rules must allow any length
+  bool pad_ones = false;
+};
+
+inline dim_rule
+dim_rule_any ()
+{
+  return { -std::numeric_limits<double>::infinity (),
+           std::numeric_limits<double>::infinity (), -1 };
+}
+
+inline bool
+dim_rule_is_any (const dim_rule& r)
+{
+  return r.tie < 0 && std::isinf (r.lo) && r.lo < 0
+         && std::isinf (r.hi) && r.hi > 0;
+}
+
+// The plain numeric pattern: the length of each dimension, or NaN for any
+// length.
+inline size_pattern
+size_pattern_from (const double *pat, std::ptrdiff_t npat)
+{
+  size_pattern sp;
+
+  sp.rules.resize (npat);
+  for (std::ptrdiff_t i = 0; i < npat; i++)
+    {
+      if (pat[i] != pat[i])
+        sp.rules[i] = dim_rule_any ();
+      else
+        sp.rules[i] = { pat[i], pat[i], -1 };
+    }
+  return sp;
+}
+
+// Whether DIMS, with NDIMS dimensions, match the pattern SP.  Returns at the
+// first dimension that does not.
+template <typename D>
+inline bool
+match_size (const D& dims, int ndims, const size_pattern& sp)
+{
+  std::ptrdiff_t npat = sp.rules.size ();
+
+  if (npat < ndims && ! sp.trailing)
+    return false;
+
+  auto len = [&dims, ndims] (std::ptrdiff_t i)
+    { return (i < ndims ? static_cast<double> (dims(i)) : 1.0); };
+
+  for (std::ptrdiff_t i = 0; i < npat; i++)
+    {
+      const dim_rule& r = sp.rules[i];
+
+      if (i >= ndims && ! sp.pad_ones)
+        {
+          if (dim_rule_is_any (r))
+            continue;
+          return false;
+        }
+
+      double d = len (i);
+      if (! (d >= r.lo && d <= r.hi))
+        return false;
+      else if (r.tie >= 0 && d != len (r.tie))
+        return false;
+    }
+  return true;
+}
+
+// Whether the kernels handle CODE for complex elements.  The others follow
+// the element-wise definitions of Octave for complex values, which the
+// generic code applies.
+inline bool
+complex_kernel (attr_code code)
+{
+  switch (code)
+    {
+      case attr_diag:
+      case attr_nonnan:
+      case attr_nonnegative:
+      case attr_nonzero:
+      case attr_finite:
+      case attr_positive:
+      case attr_gt:
+      case attr_ge:
+      case attr_lt:
+      case attr_le:
+      case attr_realvalued:
+      case attr_castable:
+        return true;
+      default:
+        return false;
+    }
+}
+
+// Run the kernel of a value attribute over an NR-by-NC column-major buffer,
+// with BOUND the operand of the comparison attributes.  Only attributes of
+// kind_value are handled, and "diag" only applies to matrices.  For complex
+// elements, see complex_kernel.
+template <typename T>
+inline std::ptrdiff_t
+scan_attr (attr_code code, const T *x, std::ptrdiff_t nr, std::ptrdiff_t nc,
+           double bound)
+{
+  std::ptrdiff_t n = nr * nc;
+
+  if constexpr (is_complex<T>::value)
+    {
+      switch (code)
+        {
+          case attr_diag:
+            return scan_diag (x, nr, nc);
+          case attr_nonnan:
+            return scan_first (x, n, viol_nan ());
+          case attr_nonnegative:
+            return scan_first (x, n, viol_nonnegative ());
+          case attr_nonzero:
+            return scan_first (x, n, viol_nonzero ());
+          case attr_finite:
+            return scan_first (x, n, viol_finite ());
+          case attr_positive:
+            return scan_first (x, n, viol_positive ());
+          case attr_gt:
+            return scan_compare (x, n, std::greater<> (), bound);
+          case attr_ge:
+            return scan_compare (x, n, std::greater_equal<> (), bound);
+          case attr_lt:
+            return scan_compare (x, n, std::less<> (), bound);
+          case attr_le:
+            return scan_compare (x, n, std::less_equal<> (), bound);
+          case attr_realvalued:
+            return scan_first (x, n, viol_imag ());
+          case attr_castable:
+            return scan_castable (x, n, bound);
+          default:
+            return -1;
+        }
+    }
+  else
+    {
+      switch (code)
+        {
+          case attr_diag:
+            return scan_diag (x, nr, nc);
+          case attr_decreasing:
+            return scan_monotone (x, n, std::less<> ());
+          case attr_nonnan:
+            return scan_first (x, n, viol_nan ());
+          case attr_nonnegative:
+            return scan_first (x, n, viol_nonnegative ());
+          case attr_nonzero:
+            return scan_first (x, n, viol_nonzero ());
+          case attr_nondecreasing:
+            return scan_monotone (x, n, std::greater_equal<> ());
+          case attr_nonincreasing:
+            return scan_monotone (x, n, std::less_equal<> ());
+          case attr_binary:
+            return scan_first (x, n, viol_binary ());
+          case attr_even:
+            return scan_first (x, n, viol_even ());
+          case attr_odd:
+            return scan_first (x, n, viol_odd ());
+          case attr_integer:
+            return scan_first (x, n, viol_integer ());
+          case attr_increasing:
+            return scan_monotone (x, n, std::greater<> ());
+          case attr_finite:
+            return scan_first (x, n, viol_finite ());
+          case attr_positive:
+            return scan_first (x, n, viol_positive ());
+          case attr_gt:
+            return scan_compare (x, n, std::greater<> (), bound);
+          case attr_ge:
+            return scan_compare (x, n, std::greater_equal<> (), bound);
+          case attr_lt:
+            return scan_compare (x, n, std::less<> (), bound);
+          case attr_le:
+            return scan_compare (x, n, std::less_equal<> (), bound);
+          case attr_castable:
+            return scan_castable (x, n, bound);
+          default:
+            return -1;
+        }
+    }
+}
+
+// scan_compare_bcast for the comparison attribute CODE.
+template <typename T>
+inline std::ptrdiff_t
+scan_bound (attr_code code, const T *x, const std::ptrdiff_t *dims,
+            int ndims, const double *bound, const std::ptrdiff_t *bdims)
+{
+  switch (code)
+    {
+      case attr_gt:
+        return scan_compare_bcast (x, dims, ndims, std::greater<> (), bound,
+                                   bdims);
+      case attr_ge:
+        return scan_compare_bcast (x, dims, ndims, std::greater_equal<> (),
+                                   bound, bdims);
+      case attr_lt:
+        return scan_compare_bcast (x, dims, ndims, std::less<> (), bound,
+                                   bdims);
+      case attr_le:
+        return scan_compare_bcast (x, dims, ndims, std::less_equal<> (),
+                                   bound, bdims);
+      default:
+        return -1;
+    }
+}
+
+// Summary of the values of an array, built a chunk at a time.  MIN and MAX
+// leave out NaN, and are only set if NUMEL > NNAN.  The order is that of the
+// monotonic attributes, so NaN breaks both.  Neither is kept for complex
+// values, whose minimum and order are not those of their parts.
+
+template <typename T>
+struct value_summary
+{
+  std::ptrdiff_t numel = 0;
+  std::ptrdiff_t nnan  = 0;
+  std::ptrdiff_t ninf  = 0;
+  std::ptrdiff_t nzero = 0;
+  T              min   = T ();
+  T              max   = T ();
+  T              last  = T ();  // to carry the order across chunks
+  bool           nondecreasing = true;
+  bool           nonincreasing = true;
+};
+
+// Add the N elements of X, which follow those already in S.
+template <typename T>
+inline void
+summarize (value_summary<T>& s, const T *x, std::ptrdiff_t n)
+{
+  if (n == 0)
+    return;
+
+  if constexpr (is_complex<T>::value)
+    {
+      std::ptrdiff_t nnan = 0, ninf = 0, nzero = 0;
+
+      for (std::ptrdiff_t i = 0; i < n; i++)
+        {
+          auto re = x[i].real ();
+          auto im = x[i].imag ();
+          nnan  += (re != re) | (im != im);
+          ninf  += std::isinf (re) | std::isinf (im);
+          nzero += (re == 0) & (im == 0);
+        }
+
+      s.nnan  += nnan;
+      s.ninf  += ninf;
+      s.nzero += nzero;
+    }
+  else
+    {
+      // MIN and MAX start from the first value that is not NaN
+      std::ptrdiff_t i = 0;
+      if (s.numel == s.nnan)
+        {
+          for (; i < n && x[i] != x[i]; i++)
+            s.nnan++;
+          if (i < n)
+            s.min = s.max = x[i];
+        }
+
+      T              mn = s.min, mx = s.max;
+      std::ptrdiff_t nnan = 0, ninf = 0, nzero = 0;
+      bool           up = true, down = true;
+
+      for (std::ptrdiff_t k = i; k < n; k++)
+        {
+          T v = x[k];
+          if constexpr (std::is_floating_point<T>::value)
+            {
+              nnan += (v != v);
+              ninf += std::isinf (v);
+            }
+          nzero += (v == T (0));
+          mn = (v < mn ? v : mn);
+          mx = (v > mx ? v : mx);
+        }
+
+      for (std::ptrdiff_t k = 1; k < n; k++)
+        {
+          up   &= ! (x[k] < x[k-1]);
+          down &= ! (x[k] > x[k-1]);
+        }
+      if (s.numel > 0)
+        {
+          up   &= ! (x[0] < s.last);
+          down &= ! (x[0] > s.last);
+        }
+
+      s.min   = mn;
+      s.max   = mx;
+      s.nnan  += nnan;
+      s.ninf  += ninf;
+      s.nzero += nzero;
+      s.last  = x[n-1];
+      s.nondecreasing = s.nondecreasing && up;
+      s.nonincreasing = s.nonincreasing && down;
+    }
+
+  s.numel += n;
+  if (s.nnan > 0)
+    s.nondecreasing = s.nonincreasing = false;
+}
+
+// Elements in a chunk of scan_fused, few enough to stay in the first level
+// cache.
+static const std::ptrdiff_t fuse_chunk = 4096;
+
+// Index of the first nonzero element off the diagonal of an NR-by-NC
+// matrix, among the elements LO to HI - 1.
+template <typename T>
+inline std::ptrdiff_t
+scan_diag_range (const T *x, std::ptrdiff_t nr, std::ptrdiff_t lo,
+                 std::ptrdiff_t hi)
+{
+  if (nr == 0)
+    return -1;
+
+  std::ptrdiff_t i = lo % nr;
+  std::ptrdiff_t j = lo / nr;
+
+  for (std::ptrdiff_t k = lo; k < hi; k++)
+    {
+      if (i != j && x[k] != T (0))
+        return k;
+      if (++i == nr)
+        {
+          i = 0;
+          j++;
+        }
+    }
+  return -1;
+}
+
+// Several value attributes in one sweep over the array.  The array is cut
+// into chunks of fuse_chunk elements, and each attribute that has not
+// failed yet runs its kernel over the chunk before the next one is loaded.
+// IDX[K] is set to the first violation of CODES[K], with BOUNDS[K] its
+// operand, or -1.  All of CODES must be handled by scan_attr for T.  Unless
+// ALL is true, only the first of CODES that fails matters: the sweep stops
+// once it is known, and the attributes after it are no longer scanned.
+// Their IDX holds the first violation if an earlier chunk had one, and
+// otherwise -1, even if they fail further on.  With SUM, the sweep always
+// goes to the end, and each chunk is also added to the summary while it is
+// in the cache.
+template <typename T>
+inline void
+scan_fused (const attr_code *codes, const double *bounds, std::size_t ncodes,
+            const T *x, std::ptrdiff_t nr, std::ptrdiff_t nc,
+            std::ptrdiff_t *idx, bool all = true,
+            value_summary<T> *sum = nullptr)
+{
+  std::ptrdiff_t n = nr * nc;
+  std::size_t    left = ncodes;   // of the first LIMIT, still passing
+  std::size_t    limit = ncodes;
+
+  for (std::size_t k = 0; k < ncodes; k++)
+    idx[k] = -1;
+
+  for (std::ptrdiff_t lo = 0; lo < n && (left > 0 || sum); lo += fuse_chunk)
+    {
+      std::ptrdiff_t hi = std::min (n, lo + fuse_chunk);
+
+      for (std::size_t k = 0; k < limit; k++)
+        {
+          if (idx[k] >= 0)
+            continue;
+
+          std::ptrdiff_t r;
+          switch (codes[k])
+            {
+              case attr_diag:
+                r = scan_diag_range (x, nr, lo, hi);
+                break;
+              case attr_decreasing:
+              case attr_nondecreasing:
+              case attr_nonincreasing:
+              case attr_increasing:
+                // the pair across the chunk boundary belongs to this chunk
+                r = (lo == 0 ? scan_attr (codes[k], x, hi, 1, bounds[k])
+                             : scan_attr (codes[k], x + lo - 1, hi - lo + 1, 1,
+                                          bounds[k]));
+                if (r >= 0 && lo > 0)
+                  r += lo - 1;
+                break;
+              default:
+                r = scan_attr (codes[k], x + lo, hi - lo, 1, bounds[k]);
+                if (r >= 0)
+                  r += lo;
+            }
+
+          if (r >= 0 && all)
+            {
+              idx[k] = r;
+              left--;
+            }
+          else if (r >= 0)
+            {
+              idx[k] = r;
+              limit = k;
+              left = 0;
+              for (std::size_t j = 0; j < limit; j++)
+                left += (idx[j] < 0);
+            }
+        }
+
+      if (sum)
+        summarize (*sum, x + lo, hi - lo);
+    }
+}
+
+// Call MARK (i) for each element of X, N in all, that breaks any of the
+// NCODES element-wise attributes CODES, with BOUNDS as for scan_fused.  An
+// element that breaks several is passed once for each.  The chunks are
+// swept as by scan_fused, and each kernel starts again after every
+// violation it finds, so the cost grows with the number of them.
+template <typename T, typename M>
+inline void
+mark_fused (const attr_code *codes, const double *bounds, std::size_t ncodes,
+            const T *x, std::ptrdiff_t n, M mark)
+{
+  for (std::ptrdiff_t lo = 0; lo < n; lo += fuse_chunk)
+    {
+      std::ptrdiff_t hi = std::min (n, lo + fuse_chunk);
+
+      for (std::size_t k = 0; k < ncodes; k++)
+        {
+          std::ptrdiff_t i = lo;
+          std::ptrdiff_t r;
+
+          while (i < hi
+                 && (r = scan_attr (codes[k], x + i, hi - i, 1,
+                                    bounds[k])) >= 0)
+            {
+              mark (i + r);
+              i += r + 1;
+            }
+        }
+    }
+}
+
+// Diagonal and permutation matrices, from their stored values only.  Their
+// other elements are zero, and are checked as a single value.
+
+// Index of the first element which is NaN or breaks x(i) OP x(i-1) in the
+// M-by-N diagonal matrix with diagonal D.
+template <typename T, typename O>
+inline std::ptrdiff_t
+scan_monotone_diag (const T *d, std::ptrdiff_t m, std::ptrdiff_t n, O op)
+{
+  std::ptrdiff_t k = std::min (m, n);
+  std::ptrdiff_t numel = m * n;
+
+  if (numel == 0)
+    return -1;
+  else if (d[0] != d[0])
+    return 0;
+
+  T prev = d[0];
+  std::ptrdiff_t pos = 0;
+
+  for (std::ptrdiff_t i = 0; ; i++)
+    {
+      // the zeros up to the next element of the diagonal, or to the end
+      std::ptrdiff_t next = (i + 1 < k ? (i + 1) * (m + 1) : numel);
+      std::ptrdiff_t nzero = next - pos - 1;
+
+      if (nzero > 0)
+        {
+          if (! op (T (0), prev))
+            return pos + 1;
+          else if (nzero > 1 && ! op (T (0), T (0)))
+            return pos + 2;
+          prev = T (0);
+        }
+
+      if (i + 1 >= k)
+        return -1;
+
+      pos = next;
+      if (! op (d[i+1], prev))
+        return pos;
+      prev = d[i+1];
+    }
+}
+
+// Run a value attribute over the M-by-N diagonal matrix with diagonal D,
+// see scan_attr.
+template <typename T>
+inline std::ptrdiff_t
+scan_diag_matrix (attr_code code, const T *d, std::ptrdiff_t m,
+                  std::ptrdiff_t n, double bound)
+{
+  if constexpr (! is_complex<T>::value)
+    {
+      switch (code)
+        {
+          case attr_decreasing:
+            return scan_monotone_diag (d, m, n, std::less<> ());
+          case attr_nondecreasing:
+            return scan_monotone_diag (d, m, n, std::greater_equal<> ());
+          case attr_nonincreasing:
+            return scan_monotone_diag (d, m, n, std::less_equal<> ());
+          case attr_increasing:
+            return scan_monotone_diag (d, m, n, std::greater<> ());
+          default:
+            break;
+        }
+    }
+
+  if (code == attr_diag)
+    return -1;
+
+  std::ptrdiff_t r = scan_attr (code, d, std::min (m, n), 1, bound);
+  std::ptrdiff_t first = (r >= 0 ? r * (m + 1) : -1);
+
+  // the first zero is element 2, right after the first of the diagonal
+  const T zero = T (0);
+  if (m * n > 1 && (first < 0 || first > 1)
+      && scan_attr (code, &zero, 1, 1, bound) >= 0)
+    first = 1;
+
+  return first;
+}
+
+// Run a value attribute over the N-by-N permutation matrix whose column J
+// has its one in row P[J], see scan_attr.
+template <typename I>
+inline std::ptrdiff_t
+scan_perm_matrix (attr_code code, const I *p, std::ptrdiff_t n, double bound)
+{
+  auto elem = [p, n] (std::ptrdiff_t i)
+    { return (p[i / n] == i % n ? 1.0 : 0.0); };
+
+  // Any permutation matrix larger than 1-by-1 breaks each monotonic
+  // attribute within its first two columns, so the loops end early.
+  auto monotone = [n, &elem] (auto op) -> std::ptrdiff_t
+    {
+      for (std::ptrdiff_t i = 1; i < n * n; i++)
+        {
+          if (! op (elem (i), elem (i-1)))
+            return i;
+        }
+      return -1;
+    };
+
+  switch (code)
+    {
+      case attr_diag:
+        for (std::ptrdiff_t j = 0; j < n; j++)
+          {
+            if (p[j] != j)
+              return j * n + p[j];
+          }
+        return -1;
+      case attr_decreasing:
+        return monotone (std::less<> ());
+      case attr_nondecreasing:
+        return monotone (std::greater_equal<> ());
+      case attr_nonincreasing:
+        return monotone (std::less_equal<> ());
+      case attr_increasing:
+        return monotone (std::greater<> ());
+      default:
+        {
+          const double one = 1;
+          const double zero = 0;
+          std::ptrdiff_t first = -1;
+
+          if (n > 0 && scan_attr (code, &one, 1, 1, bound) >= 0)
+            first = p[0];
+
+          if (n > 1 && scan_attr (code, &zero, 1, 1, bound) >= 0)
+            {
+              std::ptrdiff_t z = (p[0] != 0 ? 0 : 1);
+              if (first < 0 || z < first)
+                first = z;
+            }
+          return first;
+        }
+    }
+}
+
+// Sampled validation.  The first and last elements are always checked, and
+// the rest of the array is split in NSAMPLE strata with one element drawn at
+// random from each, so that a run of violations longer than N/NSAMPLE is
+// always caught.  Returns the number of indices written to IDX, which must
+// have room for NSAMPLE + 2, in increasing order.
+template <typename R>
+inline std::ptrdiff_t
+sample_indices (std::ptrdiff_t n, std::ptrdiff_t nsample, R& rng,
+                std::ptrdiff_t *idx)
+{
+  std::ptrdiff_t k = 0;
+
+  if (n <= 0)
+    return 0;
+
+  idx[k++] = 0;
+
+  std::ptrdiff_t inner = n - 2;
+  for (std::ptrdiff_t s = 0; s < nsample && inner > 0; s++)
+    {
+      std::ptrdiff_t lo = 1 + (inner * s) / nsample;
+      std::ptrdiff_t hi = 1 + (inner * (s + 1)) / nsample;
+      if (hi > lo)
+        idx[k++] = lo + static_cast<std::ptrdiff_t> (rng () % (hi - lo));
+    }
+
+  if (n > 1)
+    idx[k++] = n - 1;
+
+  return k;
+}
+
+// Check a value attribute at the NIDX sorted indices IDX only, see
+// scan_attr.  The monotonic attributes check the pair ending at each index.
+template <typename T>
+inline std::ptrdiff_t
+sample_attr (attr_code code, const T *x, std::ptrdiff_t nr, std::ptrdiff_t nc,
+             double bound, const std::ptrdiff_t *idx, std::ptrdiff_t nidx)
+{
+  for (std::ptrdiff_t k = 0; k < nidx; k++)
+    {
+      std::ptrdiff_t i = idx[k];
+      std::ptrdiff_t r;
+
+      switch (code)
+        {
+          case attr_diag:
+            r = ((i % nr) != (i / nr) && x[i] != T (0)) ? 0 : -1;
+            break;
+          case attr_decreasing:
+          case attr_nondecreasing:
+          case attr_nonincreasing:
+          case attr_increasing:
+            r = (i == 0 ? scan_attr (code, x, 1, 1, bound)
+                        : scan_attr (code, x + i - 1, 2, 1, bound));
+            if (r > 0)
+              r = 0;
+            break;
+          default:
+            r = scan_attr (code, x + i, 1, 1, bound);
+        }
+
+      if (r >= 0)
+        return i;
+    }
+  return -1;
+}
+
+// Sparse matrices, from their compressed column storage: column J of the
+// NR-by-NC matrix holds the stored elements CIDX[J] to CIDX[J+1] - 1, whose
+// rows are in RIDX.  The pattern attributes return the linear index of the
+// element that breaks them.
+
+// The element after the first MAXN stored in the first column that holds
+// more than MAXN, or -1.
+template <typename I>
+inline std::ptrdiff_t
+scan_sparse_colnnz (const I *cidx, const I *ridx, std::ptrdiff_t nr,
+                    std::ptrdiff_t nc, std::ptrdiff_t maxn)
+{
+  for (std::ptrdiff_t j = 0; j < nc; j++)
+    {
+      if (cidx[j+1] - cidx[j] > maxn)
+        return j * nr + ridx[cidx[j] + maxn];
+    }
+  return -1;
+}
+
+// The first stored element whose row is not past that of the one stored
+// before it in the same column, or -1.
+template <typename I>
+inline std::ptrdiff_t
+scan_sparse_sorted (const I *cidx, const I *ridx, std::ptrdiff_t nr,
+                    std::ptrdiff_t nc)
+{
+  for (std::ptrdiff_t j = 0; j < nc; j++)
+    {
+      for (I k = cidx[j] + 1; k < cidx[j+1]; k++)
+        {
+          if (ridx[k] <= ridx[k-1])
+            return j * nr + ridx[k];
+        }
+    }
+  return -1;
+}
+
+// The linear index of stored element K of a sparse matrix, or -1 if K is
+// negative.
+template <typename I>
+inline std::ptrdiff_t
+sparse_index (const I *cidx, const I *ridx, std::ptrdiff_t nr,
+              std::ptrdiff_t nc, std::ptrdiff_t k)
+{
+  if (k < 0)
+    return -1;
+
+  std::ptrdiff_t j = std::upper_bound (cidx, cidx + nc + 1, I (k)) - cidx - 1;
+  return j * nr + ridx[k];
+}
+
+// The first stored zero, or -1.
+template <typename T, typename I>
+inline std::ptrdiff_t
+scan_sparse_zeros (const T *data, const I *cidx, const I *ridx,
+                   std::ptrdiff_t nr, std::ptrdiff_t nc)
+{
+  return sparse_index (cidx, ridx, nr, nc,
+                       scan_first (data, cidx[nc], viol_nonzero ()));
+}
+
+// As scan_sparse_colnnz, for the NR-by-NC full array X.
+template <typename T>
+inline std::ptrdiff_t
+scan_dense_colnnz (const T *x, std::ptrdiff_t nr, std::ptrdiff_t nc,
+                   std::ptrdiff_t maxn)
+{
+  if (nr <= maxn)
+    return -1;
+
+  for (std::ptrdiff_t j = 0; j < nc; j++)
+    {
+      const T       *col = x + j * nr;
+      std::ptrdiff_t count = 0;
+
+      for (std::ptrdiff_t i = 0; i < nr; i++)
+        {
+          if (col[i] != T (0) && ++count > maxn)
+            return j * nr + i;
+        }
+    }
+  return -1;
+}
+
+#endif
@@ -20,9 +20,33 @@ along with Octave; see the file COPYING.  If not, see
 
 */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <system_error>
+#include <thread>
+#include <vector>
+
 #include <octave/builtin-defun-decls.h>
-#include <octave/oct-string.h>
+#include <octave/interpreter.h>
+#include <octave/oct-map.h>
 #include <octave/oct.h>
+#include <octave/profiler.h>
+
+#include "validateattributes-kernels.h"
 
 static bool
 has_any (const octave_value& ov)
@@ -122,12 +146,13 @@ cls_error (const std::string& err_ini, Array<std::string> cls,
   error_with_id ("Octave:invalid-type", err_str.c_str());
 }
 
+// WHERE is appended to the message, see violation_str.
 static void
 err_attr (const std::string& err_id, const std::string& err_ini,
-          const std::string& attr_name)
+          const std::string& attr_name, const std::string& where = "")
 {
-  error_with_id (err_id.c_str(), "%s must be %s", err_ini.c_str (),
-                 attr_name.c_str ());
+  error_with_id (err_id.c_str(), "%s must be %s%s", err_ini.c_str (),
+                 attr_name.c_str (), where.c_str ());
 }
 
 static void
@@ -138,65 +163,138 @@ err_attr (const std::string& attr_name)
                  attr_name.c_str());
 }
 
-static bool
-chk_size (const dim_vector& A_dims, octave_idx_type A_ndims,
-          const octave_value& attr_val)
+// Format V with the printf format FMT, but write NaN and Inf like Octave.
+static std::string
+fmt_value (double v, const char *fmt = "%g")
 {
+  if (std::isnan (v))
+    return "NaN";
+  else if (std::isinf (v))
+    return v < 0 ? "-Inf" : "Inf";
 
-  int             i;
-  Matrix          dims_as_mat;
-  boolMatrix      attr_isnan;
+  // "%f" of a large V runs to a hundred digits and more
+  std::vector<char> buf (std::snprintf (nullptr, 0, fmt, v) + 1);
+  std::snprintf (buf.data (), buf.size (), fmt, v);
+  return buf.data ();
+}
 
-  octave_value    attr_vev = attr_val.reshape (dim_vector (attr_val.numel (),
-                                                           1));
-  octave_idx_type attr_numel   = attr_val.numel ();
+// Parse the value of the "size" attribute: a numeric vector with NaN for
+// any length, or a cell array whose elements are a length, NaN, a range
+// [MIN MAX], "=K" for the length of dimension K, or, as the last one, "..."
+// for any number of further dimensions.
+static size_pattern
+parse_size (const octave_value& attr_val)
+{
+  if (! attr_val.iscell ())
+    {
+      NDArray pat = attr_val.array_value ();
+      return size_pattern_from (pat.data (), pat.numel ());
+    }
 
-  if (attr_numel < A_ndims)
-    return false;
+  const double inf = std::numeric_limits<double>::infinity ();
 
-  attr_isnan = (attr_vev.isnan ()).bool_matrix_value ();
+  Cell            pat = attr_val.cell_value ();
+  octave_idx_type npat = pat.numel ();
+  size_pattern    sp;
 
-  dims_as_mat = Matrix (attr_numel, 1);
-  for (i = 0; i < attr_numel; i++)
+  sp.pad_ones = true;
+
+  for (octave_idx_type i = 0; i < npat; i++)
     {
-      if(i < A_ndims)
+      const octave_value& e = pat(i);
+      bool valid = false;
+
+      if (e.is_string ())
         {
-          dims_as_mat(i) = A_dims(i);
+          std::string str = e.string_value ();
+
+          if (str == "..." && i == npat - 1)
+            {
+              sp.trailing = true;
+              valid = true;
+            }
+          else if (str.length () > 1 && str[0] == '=')
+            {
+              char *end;
+              long k = std::strtol (str.c_str () + 1, &end, 10);
+              if (*end == '\0' && k >= 1 && k <= npat && k != i + 1)
+                {
+                  sp.rules.push_back ({-inf, inf, static_cast<int> (k - 1)});
+                  valid = true;
+                }
+            }
         }
-      else if (! attr_isnan(i))
+      else if ((e.isnumeric () || e.islogical ()) && e.isreal ()
+               && (e.numel () == 1 || e.numel () == 2))
         {
-          return false;
+          NDArray v = e.array_value ();
+          double lo = v(0);
+          double hi = v(v.numel () - 1);
+
+          if (v.numel () == 1 && std::isnan (lo))
+            sp.rules.push_back (dim_rule_any ());
+          else
+            sp.rules.push_back ({std::isnan (lo) ? -inf : lo,
+                                 std::isnan (hi) ? inf : hi, -1});
+          valid = true;
         }
+
+      if (! valid)
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes: invalid element %ld of SIZE",
+                       static_cast<long> (i + 1));
+    }
+
+  for (const dim_rule& r : sp.rules)
+    {
+      if (r.tie >= static_cast<int> (sp.rules.size ()))
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes: SIZE ties to dimension %d, past "
+                       "its end", r.tie + 1);
+    }
+
+  return sp;
+}
+
+// As sprintf ("%ix", SIZE) with NaN written as N, and MIN:MAX for ranges.
+static std::string
+size_str (const size_pattern& sp)
+{
+  auto len_str = [] (double v)
+    { return fmt_value (v, v == std::round (v) ? "%.0f" : "%g"); };
+
+  std::string str;
+
+  for (std::size_t i = 0; i < sp.rules.size (); i++)
+    {
+      const dim_rule& r = sp.rules[i];
+
+      if (i > 0)
+        str += 'x';
+
+      if (r.tie >= 0)
+        str += '=' + std::to_string (r.tie + 1);
+      else if (dim_rule_is_any (r))
+        str += 'N';
+      else if (r.lo == r.hi)
+        str += len_str (r.lo);
       else
-        {
-          dims_as_mat(i) = 0;
-        }
+        str += len_str (std::max (r.lo, 0.0)) + ':' + len_str (r.hi);
     }
-  return has_all (op_el_or(dims_as_mat == attr_vev, attr_isnan));
+
+  if (sp.trailing)
+    str += (sp.rules.empty () ? "..." : "x...");
+
+  return str;
 }
 
 static void
 err_size (const octave_value& ov_A, const octave_value& attr_val,
           const std::string& err_ini)
 {
-  octave_value_list args (3);
-  args (0) = octave_value ("%dx");
-  args (1) = Fsize (ov_A)(0);
-  std::string A_dims_str = Fsprintf (args.slice (0, 2))(0).string_value ();
-  A_dims_str = A_dims_str.substr (0, A_dims_str.length () - 1);
-
-  args (0) = octave_value ("%ix");
-  args (1) = attr_val;
-
-  args (0) = Fsprintf (args.slice (0, 2))(0);
-  args (1) = octave_value ("NaN");
-  args (2) = octave_value ("N");
-  std::string attr_dims_str = (Fstrrep(args)(0).string_value ());
-  attr_dims_str = attr_dims_str.substr (0, attr_dims_str.length () - 1);
-
   error_with_id ("Octave:incorrect-size", "%s must be of size %s but was %s",
-                 err_ini.c_str (), attr_dims_str.c_str (),
-                 A_dims_str.c_str ());
+                 err_ini.c_str (), size_str (parse_size (attr_val)).c_str (),
+                 ov_A.dims ().str ().c_str ());
 }
 
 template<typename O>
@@ -227,23 +325,13 @@ chk_odd (const octave_value& A_vec)
   return has_all (Fmod (args)(0) == 1);
 }
 
+// A OP BOUND must hold for all elements, with BOUND broadcast against A.
 template<typename O>
 static bool
-chk_compare (const octave_value& A_vec, const octave_value& attr_val, O op)
-{
-  return has_all (op (A_vec, attr_val).all ());
-}
-
-static void
-err_compare (const std::string& tag, const std::string& cmp_str,
-             const std::string& err_ini,
-             const octave_value& attr_val)
+chk_compare (const octave_value& ov_A, const octave_value& attr_val, O op)
 {
-  octave_value_list args (2);
-
-  args(0) = octave_value (err_ini + " must be " + cmp_str + " %f");
-  args(1) = octave_value (attr_val);
-  error_with_id (tag.c_str (), Fsprintf (args)(0).string_value ().c_str ());
+  octave_value ok = op (ov_A, attr_val);
+  return has_all (ok.reshape (dim_vector (ok.numel (), 1)));
 }
 
 static bool
@@ -260,998 +348,5107 @@ chk_diag (const octave_value& ov_A)
     return false;
 }
 
-static void
-chk_attributes (const octave_value& ov_A, const Cell& attr,
-                const std::string& err_ini)
+// Profiling counters, see validateattributes_stats.  The enable flag is the
+// only thing touched when they are off.
+
+static const int stats_class_row = attr_num_codes;     // row for chk_class
+static const int stats_fused_row = attr_num_codes + 1; // fuse_attributes
+static const int stats_num_rows  = attr_num_codes + 2;
+
+struct stats_counter
 {
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> elements;
+  std::atomic<uint64_t> nsec;
+  std::atomic<uint64_t> failures;
+};
 
-  size_t          len;
-  std::string     name;
-  octave_value    attr_val;
-  octave_idx_type i;
+static std::atomic<bool> stats_enabled (false);
 
-  dim_vector      A_dims  = ov_A.dims ();
-  octave_value    A_vec   = ov_A.reshape (dim_vector (ov_A.numel (), 1));;
-  octave_idx_type A_ndims = ov_A.ndims ();
+static stats_counter stats_table[stats_num_rows][btyp_num_types + 1];
 
-  i = 0;
-  while (i < attr.numel ())
+// The class of each builtin_type_t, as class () names it.  Complex values
+// are told apart by the "complex" field instead.
+static const char *stats_class_names[btyp_num_types + 1] =
+{
+  "double", "single", "double", "single",
+  "int8", "int16", "int32", "int64",
+  "uint8", "uint16", "uint32", "uint64",
+  "logical", "char", "struct", "cell", "function_handle", "other"
+};
+
+class stats_probe
+{
+public:
+
+  stats_probe (int row, builtin_type_t btyp, octave_idx_type nel)
+    : m_counter (nullptr), m_failed (false)
+  {
+    if (stats_enabled.load (std::memory_order_relaxed))
+      {
+        int col = (btyp < btyp_num_types ? btyp : btyp_num_types);
+        m_counter = &stats_table[row][col];
+        m_nel = nel;
+        m_start = std::chrono::steady_clock::now ();
+      }
+  }
+
+  stats_probe (const stats_probe&) = delete;
+
+  stats_probe& operator = (const stats_probe&) = delete;
+
+  ~stats_probe ()
+  {
+    if (! m_counter)
+      return;
+
+    auto nsec = std::chrono::duration_cast<std::chrono::nanoseconds>
+                  (std::chrono::steady_clock::now () - m_start).count ();
+
+    m_counter->calls.fetch_add (1, std::memory_order_relaxed);
+    m_counter->elements.fetch_add (m_nel, std::memory_order_relaxed);
+    m_counter->nsec.fetch_add (nsec, std::memory_order_relaxed);
+    if (m_failed)
+      m_counter->failures.fetch_add (1, std::memory_order_relaxed);
+  }
+
+  void fail () { m_failed = true; }
+
+  void set_elements (octave_idx_type nel) { m_nel = nel; }
+
+private:
+
+  stats_counter *m_counter;
+  bool m_failed;
+  octave_idx_type m_nel;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// A phase of a validateattributes call as seen by the Octave profiler, where
+// it shows up as "validateattributes>PHASE".  octave::profiler::enter only
+// asks for the name when profiling is on.
+
+class profile_phase
+{
+public:
+
+  profile_phase (const char *phase) : m_phase (phase) { }
+
+  std::string profiler_name () const
+  {
+    return std::string ("validateattributes>") + m_phase;
+  }
+
+private:
+
+  const char *m_phase;
+};
+
+typedef octave::profiler::enter<profile_phase> profile_block;
+
+// Call FCN with a pointer to the elements of A, for the dense real arrays
+// that the kernels handle.  Return false for any other type, which is left to
+// the generic octave_value code.
+template <typename F>
+static bool
+visit_array (const octave_value& ov_A, F fcn)
+{
+  if (ov_A.issparse () || ov_A.is_diag_matrix () || ov_A.is_perm_matrix ())
+    return false;
+
+  switch (ov_A.builtin_type ())
+    {
+      case btyp_double:
+        {
+          NDArray a = ov_A.array_value ();
+          fcn (a.data ());
+          return true;
+        }
+      case btyp_float:
+        {
+          FloatNDArray a = ov_A.float_array_value ();
+          fcn (a.data ());
+          return true;
+        }
+      case btyp_complex:
+        {
+          ComplexNDArray a = ov_A.complex_array_value ();
+          fcn (a.data ());
+          return true;
+        }
+      case btyp_float_complex:
+        {
+          FloatComplexNDArray a = ov_A.float_complex_array_value ();
+          fcn (a.data ());
+          return true;
+        }
+      case btyp_int8:
+        {
+          int8NDArray a = ov_A.int8_array_value ();
+          fcn (reinterpret_cast<const int8_t *> (a.data ()));
+          return true;
+        }
+      case btyp_int16:
+        {
+          int16NDArray a = ov_A.int16_array_value ();
+          fcn (reinterpret_cast<const int16_t *> (a.data ()));
+          return true;
+        }
+      case btyp_int32:
+        {
+          int32NDArray a = ov_A.int32_array_value ();
+          fcn (reinterpret_cast<const int32_t *> (a.data ()));
+          return true;
+        }
+      case btyp_int64:
+        {
+          int64NDArray a = ov_A.int64_array_value ();
+          fcn (reinterpret_cast<const int64_t *> (a.data ()));
+          return true;
+        }
+      case btyp_uint8:
+        {
+          uint8NDArray a = ov_A.uint8_array_value ();
+          fcn (reinterpret_cast<const uint8_t *> (a.data ()));
+          return true;
+        }
+      case btyp_uint16:
+        {
+          uint16NDArray a = ov_A.uint16_array_value ();
+          fcn (reinterpret_cast<const uint16_t *> (a.data ()));
+          return true;
+        }
+      case btyp_uint32:
+        {
+          uint32NDArray a = ov_A.uint32_array_value ();
+          fcn (reinterpret_cast<const uint32_t *> (a.data ()));
+          return true;
+        }
+      case btyp_uint64:
+        {
+          uint64NDArray a = ov_A.uint64_array_value ();
+          fcn (reinterpret_cast<const uint64_t *> (a.data ()));
+          return true;
+        }
+      case btyp_bool:
+        {
+          boolNDArray a = ov_A.bool_array_value ();
+          fcn (a.data ());
+          return true;
+        }
+      case btyp_char:
+        {
+          // char values are compared as their unsigned codes, like double
+          // does
+          charNDArray a = ov_A.char_array_value ();
+          fcn (reinterpret_cast<const unsigned char *> (a.data ()));
+          return true;
+        }
+      default:
+        return false;
+    }
+}
+
+// Call FCN with DATA, the data of an array of builtin type BTYP as returned
+// by mex_get_data, as the same typed pointer as visit_array.  Does not use
+// the interpreter.
+template <typename F>
+static bool
+visit_data (builtin_type_t btyp, void *data, F fcn)
+{
+  switch (btyp)
+    {
+      case btyp_double:
+        fcn (static_cast<const double *> (data));
+        return true;
+      case btyp_float:
+        fcn (static_cast<const float *> (data));
+        return true;
+      case btyp_complex:
+        fcn (static_cast<const Complex *> (data));
+        return true;
+      case btyp_float_complex:
+        fcn (static_cast<const FloatComplex *> (data));
+        return true;
+      case btyp_int8:
+        fcn (static_cast<const int8_t *> (data));
+        return true;
+      case btyp_int16:
+        fcn (static_cast<const int16_t *> (data));
+        return true;
+      case btyp_int32:
+        fcn (static_cast<const int32_t *> (data));
+        return true;
+      case btyp_int64:
+        fcn (static_cast<const int64_t *> (data));
+        return true;
+      case btyp_uint8:
+        fcn (static_cast<const uint8_t *> (data));
+        return true;
+      case btyp_uint16:
+        fcn (static_cast<const uint16_t *> (data));
+        return true;
+      case btyp_uint32:
+        fcn (static_cast<const uint32_t *> (data));
+        return true;
+      case btyp_uint64:
+        fcn (static_cast<const uint64_t *> (data));
+        return true;
+      case btyp_bool:
+        fcn (static_cast<const bool *> (data));
+        return true;
+      case btyp_char:
+        fcn (static_cast<const unsigned char *> (data));
+        return true;
+      default:
+        return false;
+    }
+}
+
+// Whether an operand of dimensions B_DIMS broadcasts to A_DIMS without
+// changing them: each of its dimensions is 1 or the same as in A.  If so,
+// fill DIMS and BDIMS with both, padded to the same length.
+static bool
+bcast_dims (const dim_vector& A_dims, const dim_vector& B_dims,
+            std::vector<std::ptrdiff_t>& dims,
+            std::vector<std::ptrdiff_t>& bdims)
+{
+  int nd = A_dims.ndims ();
+
+  if (B_dims.ndims () > nd)
+    return false;
+
+  dims.resize (nd);
+  bdims.resize (nd);
+  for (int k = 0; k < nd; k++)
     {
-      name = attr (i++).string_value ();
-      len = name.length ();
+      dims[k] = A_dims(k);
+      bdims[k] = (k < B_dims.ndims () ? B_dims(k) : 1);
+      if (bdims[k] != 1 && bdims[k] != dims[k])
+        return false;
+    }
+  return true;
+}
+
+// A value attribute set up for the kernels, which can then run without
+// the interpreter.
+struct native_scan
+{
+  attr_code                   code;
+  octave_idx_type             nr = 0;
+  octave_idx_type             nc = 0;
+  double                      bound = 0;
 
-      if (len < 1)
-        err_attr (name);
+  // operand of a comparison that is not a scalar, see scan_bound
+  std::vector<double>         bounds;
+  std::vector<std::ptrdiff_t> dims;
+  std::vector<std::ptrdiff_t> bdims;
+};
 
-      switch (std::tolower (name[0]))
+// Whether the int64 or uint64 operand VAL has a value that a double does not
+// hold exactly.  The kernels take the operand as double, so they would
+// compare against it rounded.
+static bool
+inexact_operand (const octave_value& val)
+{
+  const int64_t lim = int64_t (1) << 53;
+
+  if (val.is_int64_type ())
+    {
+      int64NDArray b = val.int64_array_value ();
+      for (octave_idx_type i = 0; i < b.numel (); i++)
         {
-          case '2': // 2d
-            {
-              if (len == 2 && std::tolower (name[1]) == 'd')
-                {
-                  if (A_ndims != 2)
-                    err_attr ("Octave:expected-2d", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case '3': // 3d
-            {
-              if (len == 2 && std::tolower (name[1]) == 'd')
-                {
-                  if (A_ndims > 3)
-                    err_attr ("Octave:expected-3d", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'c': // column
-            {
-              if (octave::string::strcmpi (name, "column"))
-                {
-                  if (A_ndims != 2 || A_dims(1) != 1)
-                    err_attr ("Octave:expected-column", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'r': // row, real
-            {
-              if (octave::string::strcmpi (name, "row")) // row
-                {
-                  if (A_ndims != 2 || A_dims(0) != 1)
-                    err_attr ("Octave:expected-row", err_ini, name);
-                }
-              else if (octave::string::strcmpi (name, "real")) // real
-                {
-                  if (! ov_A.isreal ())
-                    err_attr ("Octave:expected-real", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 's': // scalar, square, size,
-            {
-              if (octave::string::strcmpi (name, "scalar")) // scalar
-                {
-                  if (ov_A.numel () != 1)
-                    err_attr ("Octave:expected-scalar", err_ini, name);
-                }
-              else if (octave::string::strcmpi (name, "square")) // square
-                {
-                  if (A_ndims != 2 || A_dims(0) != A_dims(1))
-                    err_attr ("Octave:expected-square", err_ini, name);
-                }
-              else if (octave::string::strcmpi (name, "size")) // size
-                {
-                  if (i >= attr.numel ())
-                    error ("Incorrect number of attribute cell arguments");
-                  attr_val = attr (i++);
-                  if (! chk_size (A_dims, A_ndims, attr_val))
-                    err_size (ov_A, attr_val, err_ini);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'v': // vector
-            {
-              if (octave::string::strcmpi (name, "vector"))
-                {
-                  if (A_ndims != 2 || (A_dims(0) != 1 && A_dims(1) != 1))
-                    err_attr ("Octave:expected-vector", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'd': // diag, decreasing
-            {
-              if (octave::string::strcmpi (name, "diag")) // diag
-                {
-                  if (! chk_diag (ov_A))
-                    err_attr ("Octave:expected-diag", err_ini, name);
-                }
-              else if (octave::string::strcmpi (name,
-                                                "decreasing")) // decreasing
-                {
-                  if (! chk_monotone (A_vec, op_lt))
-                    err_attr ("Octave:expected-decreasing", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'n': // nonempty, nonsparse, nonnan, nonnegative, nonzero,
-            // nondecreasing, nonincreasing, numel, ncols, nrows, ndims
-            {
+          if (b(i).value () > lim || b(i).value () < -lim)
+            return true;
+        }
+    }
+  else if (val.is_uint64_type ())
+    {
+      uint64NDArray b = val.uint64_array_value ();
+      for (octave_idx_type i = 0; i < b.numel (); i++)
+        {
+          if (b(i).value () > uint64_t (lim))
+            return true;
+        }
+    }
+  return false;
+}
 
-              if (len < 2)
-                err_attr (name);
+// Return false if A or the operand is of a type the kernels do not handle,
+// or the operand is an integer they would not compare exactly.
+static bool
+prepare_native (attr_code code, const octave_value& attr_val,
+                const octave_value& ov_A, const dim_vector& A_dims,
+                native_scan& scan)
+{
+  if (ov_A.iscomplex () && ! complex_kernel (code))
+    return false;
 
-              switch (std::tolower (name[1]))
-                {
-                  case 'o': // nonempty, nonsparse, nonnan, nonnegative,
-                    // nonzero, nondecreasing, nonincreasing
-                    {
+  scan.code = code;
+  scan.nr = A_dims(0);
+  scan.nc = (scan.nr > 0 ? A_dims.numel () / scan.nr : 0);
 
-                      if (len < 4)
-                        err_attr (name);
+  if (code == attr_diag)
+    {
+      if (A_dims.ndims () != 2 || ! (ov_A.isnumeric () || ov_A.islogical ()))
+        return false;
+    }
+  else if (code == attr_castable)
+    scan.bound = cast_lookup (attr_val.string_value ());
+  else if (attr_table[code].has_value)
+    {
+      if (! attr_val.isnumeric () || ! attr_val.isreal ()
+          || attr_val.issparse () || inexact_operand (attr_val))
+        return false;
 
-                      switch (std::tolower (name[3]))
-                        {
-                          case 'e':  // nonempty
-                            {
-                              if (octave::string::strcmpi (name, "nonempty"))
-                                {
-                                  if (ov_A.isempty ())
-                                    err_attr ("Octave:expected-nonempty",
-                                              err_ini, name);
-                                }
-                              else
-                                err_attr (name);
-                              break;
-                            }
-                          case 's': // nonsparse
-                            {
-                              if (octave::string::strcmpi (name, "nonsparse"))
-                                {
-                                  if (ov_A.issparse ())
-                                    err_attr ("Octave:expected-nonsparse",
-                                              err_ini, name);
-                                }
-                              else
-                                err_attr (name);
-                              break;
-                            }
-                          case 'n': // nonnan, nonnegative
-                            {
-                              if (octave::string::strcmpi (name, "nonnan"))
-                                { // nonnan
-                                  if (! ov_A.isinteger ()
-                                      && has_any(A_vec.isnan ()))
-                                    err_attr ("Octave:expected-nonnan",
-                                              err_ini, name);
-                                }
-                              else if (octave::string::strcmpi (name,
-                                                                "nonnegative"))
-                                { // nonnegative
-                                  if (has_any(A_vec < 0))
-                                    err_attr ("Octave:expected-nonnegative",
-                                              err_ini, name);
-                                }
-                              else
-                                err_attr (name);
-                              break;
-                            }
-                          case 'z': // nonzero
-                            {
-                              if (octave::string::strcmpi (name, "nonzero"))
-                                {
-                                  if (has_any(A_vec == 0))
-                                    err_attr ("Octave:expected-nonzero", err_ini,
-                                              name);
-                                }
-                              else
-                                err_attr (name);
-                              break;
-                            }
-                          case 'd': // nondecreasing
-                            {
-                              if (octave::string::strcmpi (name,
-                                                           "nondecreasing"))
-                                {
-                                  if (! chk_monotone (A_vec, op_ge))
-                                    err_attr ("Octave:expected-nondecreasing",
-                                              err_ini, name);
-                                }
-                              else
-                                err_attr (name);
-                              break;
-                            }
-                          case 'i': // nonincreasing
-                            {
-                              if (octave::string::strcmpi (name,
-                                                           "nonincreasing"))
-                                {
-                                  if (! chk_monotone (A_vec, op_le))
-                                    err_attr ("Octave:expected-nonincreasing",
-                                              err_ini, name);
-                                }
-                              else
-                                err_attr (name);
-                              break;
-                            }
-                          default:
-                            err_attr (name);
-                        }
-                      break;
-                    }
-                  case 'u': // numel
-                    {
-                      if (octave::string::strcmpi (name, "numel"))
-                        {
-                          if (i >= attr.numel ())
-                            error ("Incorrect number of attribute cell "
-                                         "arguments");
-                          attr_val = attr (i++);
-                          if (ov_A.numel () != attr_val.idx_type_value ())
-                            {
-                              error_with_id ("Octave:incorrect-numel",
-                                             "%s must have %l elements",
-                                             err_ini.c_str(),
-                                             attr_val.idx_type_value ());
-                            }
-                        }
-                      else
-                        err_attr (name);
-                      break;
-                    }
-                  case 'c': // ncols
-                    {
-                      if (octave::string::strcmpi (name, "ncols"))
-                        {
-                          if (i >= attr.numel ())
-                            error ("Incorrect number of attribute cell "
-                                         "arguments");
-                          attr_val = attr (i++);
-                          if (A_ndims < 2
-                              || A_dims(1) != attr_val.idx_type_value ())
-                            {
-                              error_with_id ("Octave:incorrect-numcols",
-                                             "%s must have %l columns",
-                                             err_ini.c_str (),
-                                             attr_val.idx_type_value ());
-                            }
-                        }
-                      else
-                        err_attr (name);
-                      break;
-                    }
-                  case 'r': // nrows
-                    {
-                      if (octave::string::strcmpi (name, "nrows"))
-                        {
-                          if (i >= attr.numel ())
-                            error ("Incorrect number of attribute cell "
-                                         "arguments");
-                          attr_val = attr (i++);
-                          if (A_ndims < 1
-                              || A_dims(0) != attr_val.idx_type_value ())
-                            {
-                              error_with_id ("Octave:incorrect-numrows",
-                                             "%s must have %l rows",
-                                             err_ini.c_str (),
-                                             attr_val.idx_type_value ());
-                            }
-                        }
-                      else
-                        err_attr (name);
-                      break;
-                    }
-                  case 'd': // ndims
-                    {
-                      if (octave::string::strcmpi (name, "ndims"))
-                        {
-                          if (i >= attr.numel ())
-                            error ("Incorrect number of attribute cell "
-                                         "arguments");
-                          attr_val = attr (i++);
-                          if (A_ndims != attr_val.idx_type_value ())
-                            {
-                              error_with_id ("Octave:incorrect-numdims",
-                                             "%s must have %l dimensions",
-                                             err_ini.c_str (),
-                                             attr_val.idx_type_value ());
-                            }
-                        }
-                      else
-                        err_attr (name);
-                      break;
-                    }
-                  default:
-                    err_attr (name);
-                }
-              break;
-            }
-          case 'b': // binary
-            {
-              if (octave::string::strcmpi (name, "binary"))
-                {
-                  if (! ov_A.islogical ()
-                      && (has_any (op_el_and ((A_vec != 1), (A_vec != 0)))))
-                    err_attr ("Octave:expected-binary", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'e': // even
-            {
-              if (octave::string::strcmpi (name, "even"))
-                {
-                  if (! chk_even (A_vec))
-                    err_attr ("Octave:expected-even", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'o': // odd
-            {
-              if (octave::string::strcmpi (name, "odd"))
-                {
-                  if (! chk_odd (A_vec))
-                    err_attr ("Octave:expected-odd", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'i': // integer, increasing
-            {
-              if (octave::string::strcmpi (name, "integer")) // integer
-                {
-                  if (! ov_A.isinteger ()
-                      && (has_any (A_vec.ceil () != A_vec)))
-                    err_attr ("Octave:expected-integer", err_ini, name);
-                }
-              else if (octave::string::strcmpi (name,
-                                                "increasing")) // increasing
-                {
-                  if (! chk_monotone (A_vec, op_gt))
-                    err_attr ("Octave:expected-increasing", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'f': // finite
-            {
-              if (octave::string::strcmpi (name, "finite"))
-                {
-                  if (! ov_A.isinteger ()
-                      && ! has_all (A_vec.isfinite ()))
-                    err_attr ("Octave:expected-finite", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case 'p': // positive
-            {
-              if (octave::string::strcmpi (name, "positive"))
-                {
-                  if (has_any (A_vec <= 0))
-                    err_attr ("Octave:expected-positive", err_ini, name);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case '>': // >, >=
-            {
-              if (len == 1) // >
-                {
-                  if (i >= attr.numel ())
-                    error ("Incorrect number of attribute cell arguments");
-                  attr_val = attr (i++);
-                  if (! chk_compare (A_vec, attr_val, op_gt))
-                    err_compare ("Octave:expected-greater", "greater than",
-                                 err_ini, attr_val);
-                }
-              else if (len == 2 && std::tolower (name[1]) == '=') // >=
-                {
-                  if (i >= attr.numel ())
-                    error ("Incorrect number of attribute cell arguments");
-                  attr_val = attr (i++);
-                  if (! chk_compare (A_vec, attr_val, op_ge))
-                    err_compare ("Octave:expected-greater-equal",
-                                 "greater than or equal to", err_ini,
-                                 attr_val);
-                }
-              else
-                err_attr (name);
-              break;
-            }
-          case '<': // <, <=
+      if (attr_val.numel () != 1)
+        {
+          if (! bcast_dims (A_dims, attr_val.dims (), scan.dims, scan.bdims))
+            return false;
+
+          NDArray b = attr_val.array_value ();
+          scan.bounds.assign (b.data (), b.data () + b.numel ());
+        }
+      else
+        scan.bound = attr_val.double_value ();
+    }
+
+  return true;
+}
+
+// Linear index of the first violation in X, or -1.  If SAMPLE is not empty
+// only the elements at those indices are checked, and SAMPLED is set.
+// Comparisons against an operand that is not a scalar are always done in
+// full.
+template <typename T>
+static octave_idx_type
+run_native (const native_scan& scan, const T *x,
+            const std::vector<std::ptrdiff_t>& sample, bool& sampled)
+{
+  if (! scan.bounds.empty ())
+    return scan_bound (scan.code, x, scan.dims.data (), scan.dims.size (),
+                       scan.bounds.data (), scan.bdims.data ());
+
+  if (! sample.empty ())
+    {
+      sampled = true;
+      return sample_attr (scan.code, x, scan.nr, scan.nc, scan.bound,
+                          sample.data (), sample.size ());
+    }
+
+  return scan_attr (scan.code, x, scan.nr, scan.nc, scan.bound);
+}
+
+// Run a value attribute with the kernels.  Return false if A or the operand
+// is of a type they do not handle, otherwise set IDX to the linear index of
+// the first violation, or -1.  See run_native for SAMPLE.
+static bool
+scan_native (attr_code code, const octave_value& attr_val,
+             const octave_value& ov_A, const dim_vector& A_dims,
+             const std::vector<std::ptrdiff_t>& sample, octave_idx_type& idx,
+             bool& sampled)
+{
+  native_scan scan;
+
+  if (! prepare_native (code, attr_val, ov_A, A_dims, scan))
+    return false;
+
+  return visit_array (ov_A, [&] (const auto *x)
+                      { idx = run_native (scan, x, sample, sampled); });
+}
+
+// Call FCN with a pointer to the stored diagonal of the diagonal matrix A,
+// without making it full.  Return false if A is not one.
+template <typename F>
+static bool
+visit_diag (const octave_value& ov_A, F fcn)
+{
+  if (! ov_A.is_diag_matrix ())
+    return false;
+
+  switch (ov_A.builtin_type ())
+    {
+      case btyp_double:
+        {
+          DiagMatrix d = ov_A.diag_matrix_value ();
+          fcn (d.data ());
+          return true;
+        }
+      case btyp_float:
+        {
+          FloatDiagMatrix d = ov_A.float_diag_matrix_value ();
+          fcn (d.data ());
+          return true;
+        }
+      case btyp_complex:
+        {
+          ComplexDiagMatrix d = ov_A.complex_diag_matrix_value ();
+          fcn (d.data ());
+          return true;
+        }
+      case btyp_float_complex:
+        {
+          FloatComplexDiagMatrix d = ov_A.float_complex_diag_matrix_value ();
+          fcn (d.data ());
+          return true;
+        }
+      default:
+        return false;
+    }
+}
+
+// Run a value attribute on a diagonal or permutation matrix from its stored
+// diagonal or permutation vector, without making it full.  Return false if
+// A is not one or the kernels do not handle the attribute, otherwise set
+// IDX as scan_native does.
+static bool
+scan_implicit (attr_code code, const octave_value& attr_val,
+               const octave_value& ov_A, const dim_vector& A_dims,
+               octave_idx_type& idx)
+{
+  if (! ov_A.is_diag_matrix () && ! ov_A.is_perm_matrix ())
+    return false;
+
+  native_scan scan;
+
+  if (! prepare_native (code, attr_val, ov_A, A_dims, scan)
+      || ! scan.bounds.empty ())
+    return false;
+
+  octave_idx_type m = A_dims(0);
+  octave_idx_type n = A_dims(1);
+
+  if (ov_A.is_perm_matrix ())
+    {
+      PermMatrix pm = ov_A.perm_matrix_value ();
+      idx = scan_perm_matrix (code, pm.col_perm_vec ().data (), n,
+                              scan.bound);
+      return true;
+    }
+
+  return visit_diag (ov_A, [&] (const auto *d)
+                     { idx = scan_diag_matrix (code, d, m, n, scan.bound); });
+}
+
+// Call FCN with the data, column starts, and row indices of the sparse
+// matrix A, without copying them.  Return false if A is not sparse.
+template <typename F>
+static bool
+visit_sparse (const octave_value& ov_A, F fcn)
+{
+  if (! ov_A.issparse ())
+    return false;
+
+  if (ov_A.islogical ())
+    {
+      const SparseBoolMatrix a = ov_A.sparse_bool_matrix_value ();
+      fcn (a.data (), a.cidx (), a.ridx ());
+    }
+  else if (ov_A.iscomplex ())
+    {
+      const SparseComplexMatrix a = ov_A.sparse_complex_matrix_value ();
+      fcn (a.data (), a.cidx (), a.ridx ());
+    }
+  else
+    {
+      const SparseMatrix a = ov_A.sparse_matrix_value ();
+      fcn (a.data (), a.cidx (), a.ridx ());
+    }
+  return true;
+}
+
+// The attributes of kind_pattern.  For a sparse A they only read its index
+// arrays, and its data for "nostoredzeros", and "maxnnz" takes the count of
+// stored elements.  A full A has no stored zeros, and its row indices are
+// sorted.  IDX is set as chk_attr does.
+static bool
+chk_pattern (attr_code code, const octave_value& attr_val,
+             const octave_value& ov_A, const dim_vector& A_dims,
+             octave_idx_type& idx)
+{
+  if (! ov_A.isnumeric () && ! ov_A.islogical () && ! ov_A.is_string ())
+    return false;
+
+  octave_idx_type nr = A_dims(0);
+  octave_idx_type nc = (ov_A.issparse () ? A_dims(1)
+                                         : nr > 0 ? A_dims.numel () / nr : 0);
+
+  auto pattern = [&] (auto scan)
+    {
+      visit_sparse (ov_A, [&] (const auto *data, const octave_idx_type *cidx,
+                               const octave_idx_type *ridx)
+                    { idx = scan (data, cidx, ridx); });
+      return idx < 0;
+    };
+
+  switch (code)
+    {
+      case attr_maxnnz:
+        return ov_A.nnz () <= attr_val.idx_type_value ();
+      case attr_maxcolnnz:
+        {
+          octave_idx_type maxn = attr_val.idx_type_value ();
+
+          if (ov_A.issparse ())
+            return pattern ([=] (const auto *, const octave_idx_type *cidx,
+                                 const octave_idx_type *ridx)
+                            {
+                              return scan_sparse_colnnz (cidx, ridx, nr, nc,
+                                                         maxn);
+                            });
+
+          // a column of a permutation matrix has exactly one nonzero
+          // element, and one of a diagonal matrix at most its element of the
+          // diagonal, so they are not made full
+          if (ov_A.is_perm_matrix ())
             {
-              if (len == 1) // <
-                {
-                  if (i >= attr.numel ())
-                    error ("Incorrect number of attribute cell arguments");
-                  attr_val = attr (i++);
-                  if (! chk_compare (A_vec, attr_val, op_lt))
-                    err_compare ("Octave:expected-less", "less than",
-                                 err_ini, attr_val);
-                }
-              else if (len == 2 && std::tolower (name[1]) == '=') // <=
-                {
-                  if (i >= attr.numel ())
-                    error ("Incorrect number of attribute cell arguments");
-                  attr_val = attr (i++);
-                  if (! chk_compare (A_vec, attr_val, op_le))
-                    err_compare ("Octave:expected-less-equal",
-                                 "less than or equal to", err_ini, attr_val);
-                }
-              else
-                err_attr (name);
-              break;
+              PermMatrix pm = ov_A.perm_matrix_value ();
+              idx = (nc > 0 && maxn < 1 ? pm.col_perm_vec ().data ()[0] : -1);
+              return idx < 0;
             }
-          default:
-            err_attr (name);
+          else if (visit_diag (ov_A, [&] (const auto *d)
+                               {
+                                 idx = scan_dense_colnnz (d, 1,
+                                                          std::min (nr, nc),
+                                                          maxn);
+                                 if (idx >= 0)
+                                   idx *= nr + 1;
+                               }))
+            return idx < 0;
+
+          visit_array (ov_A, [&] (const auto *x)
+                       { idx = scan_dense_colnnz (x, nr, nc, maxn); });
+          return idx < 0;
         }
+      case attr_nostoredzeros:
+        return pattern ([=] (const auto *data, const octave_idx_type *cidx,
+                             const octave_idx_type *ridx)
+                        { return scan_sparse_zeros (data, cidx, ridx, nr, nc); });
+      case attr_sortedindices:
+        return pattern ([=] (const auto *, const octave_idx_type *cidx,
+                             const octave_idx_type *ridx)
+                        { return scan_sparse_sorted (cidx, ridx, nr, nc); });
+      default:
+        return false;
     }
 }
 
-DEFUN_DLD (validateattributes, args, nargout, "-*- texinfo -*-\n\
-@deftypefn  {} {} validateattributes (@var{A}, @var{classes}, @var{attributes})\n\
-@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{arg_idx})\n\
-@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{func_name})\n\
-@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{func_name}, @var{arg_name})\n\
-@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{func_name}, @var{arg_name}, @var{arg_idx})\n\
-Check validity of input argument.\n\
-\n\
-Confirms that the argument @var{A} is valid by belonging to one of\n\
-@var{classes}, and holding all of the @var{attributes}.  If it does not,\n\
-an error is thrown, with a message formatted accordingly.  The error\n\
-message can be made further complete by the function name @var{fun_name},\n\
-the argument name @var{arg_name}, and its position in the input\n\
-@var{arg_idx}.\n\
-\n\
-@var{classes} must be a cell array of strings (an empty cell array is\n\
-allowed) with the name of classes (remember that a class name is case\n\
-sensitive).  In addition to the class name, the following categories\n\
-names are also valid:\n\
-\n\
-@table @asis\n\
-@item @qcode{\"float\"}\n\
-Floating point value comprising classes @qcode{\"double\"} and\n\
-@qcode{\"single\"}.\n\
-\n\
-@item @qcode{\"integer\"}\n\
-Integer value comprising classes (u)int8, (u)int16, (u)int32, (u)int64.\n\
-\n\
-@item @qcode{\"numeric\"}\n\
-Numeric value comprising either a floating point or integer value.\n\
-\n\
-@end table\n\
-\n\
-@var{attributes} must be a cell array with names of checks for @var{A}.\n\
-Some of them require an additional value to be supplied right after the\n\
-name (see details for each below).\n\
-\n\
-@table @asis\n\
-@item @qcode{\"<=\"}\n\
-All values are less than or equal to the following value in\n\
-@var{attributes}.\n\
-\n\
-@item @qcode{\"<\"}\n\
-All values are less than the following value in @var{attributes}.\n\
-\n\
-@item @qcode{\">=\"}\n\
-All values are greater than or equal to the following value in\n\
-@var{attributes}.\n\
-\n\
-@item @qcode{\">\"}\n\
-All values are greater than the following value in @var{attributes}.\n\
-\n\
-@item @qcode{\"2d\"}\n\
-A 2-dimensional matrix.  Note that vectors and empty matrices have\n\
-2 dimensions, one of them being of length 1, or both length 0.\n\
-\n\
-@item @qcode{\"3d\"}\n\
-Has no more than 3 dimensions.  A 2-dimensional matrix is a 3-D matrix\n\
-whose 3rd dimension is of length 1.\n\
-\n\
-@item @qcode{\"binary\"}\n\
-All values are either 1 or 0.\n\
-\n\
-@item @qcode{\"column\"}\n\
-Values are arranged in a single column.\n\
-\n\
-@item @qcode{\"decreasing\"}\n\
-No value is @var{NaN}, and each is less than the preceding one.\n\
-\n\
-@item @qcode{\"diag\"}\n\
-Value is a diagonal matrix.\n\
-\n\
-@item @qcode{\"even\"}\n\
-All values are even numbers.\n\
-\n\
-@item @qcode{\"finite\"}\n\
-All values are finite.\n\
-\n\
-@item @qcode{\"increasing\"}\n\
-No value is @var{NaN}, and each is greater than the preceding one.\n\
-\n\
-@item @qcode{\"integer\"}\n\
-All values are integer.  This is different than using @code{isinteger}\n\
-which only checks its an integer type.  This checks that each value in\n\
-@var{A} is an integer value, i.e., it has no decimal part.\n\
-\n\
-@item @qcode{\"ncols\"}\n\
-Has exactly as many columns as the next value in @var{attributes}.\n\
-\n\
-@item @qcode{\"ndims\"}\n\
-Has exactly as many dimensions as the next value in @var{attributes}.\n\
-\n\
-@item @qcode{\"nondecreasing\"}\n\
-No value is @var{NaN}, and each is greater than or equal to the preceding\n\
-one.\n\
-\n\
-@item @qcode{\"nonempty\"}\n\
-It is not empty.\n\
-\n\
-@item @qcode{\"nonincreasing\"}\n\
-No value is @var{NaN}, and each is less than or equal to the preceding one.\n\
+// "castable" where the kernels do not see A as an array.  For a sparse A
+// only the stored values are checked, since zero converts to any class.
+// Values of other types do not convert.
+static bool
+chk_castable (const octave_value& attr_val, const octave_value& ov_A,
+              const dim_vector& A_dims, octave_idx_type& idx)
+{
+  double to = cast_lookup (attr_val.string_value ());
+
+  octave_idx_type nr = A_dims(0);
+  octave_idx_type nc = (nr > 0 ? A_dims.numel () / nr : A_dims(1));
+
+  return (visit_sparse (ov_A, [&] (const auto *data,
+                                   const octave_idx_type *cidx,
+                                   const octave_idx_type *ridx)
+                        {
+                          idx = sparse_index (cidx, ridx, nr, nc,
+                                              scan_castable (data, cidx[nc],
+                                                             to));
+                        })
+          && idx < 0);
+}
+
+// One entry of ATTRIBUTES.
+struct attr_op
+{
+  attr_code    code;
+  std::string  name;
+  octave_value val;
+  size_pattern size;  // parsed VAL of "size"
+};
+
+// SAMPLED is set if the check only looked at the elements in SAMPLE.  IDX
+// is set to the linear index of the first violation if the kernels found
+// it, otherwise to -1.
+static bool
+chk_attr (const attr_op& op, const octave_value& ov_A, octave_value& A_vec,
+          const dim_vector& A_dims, octave_idx_type A_ndims,
+          const std::vector<std::ptrdiff_t>& sample, bool& sampled,
+          octave_idx_type& idx)
+{
+  attr_code           code     = op.code;
+  const octave_value& attr_val = op.val;
+
+  sampled = false;
+  idx = -1;
+
+  if (attr_table[code].kind == kind_value)
+    {
+      if (scan_implicit (code, attr_val, ov_A, A_dims, idx)
+          || scan_native (code, attr_val, ov_A, A_dims, sample, idx, sampled))
+        return idx < 0;
+
+      // A as a column, only made for the generic checks
+      if (A_vec.is_undefined ())
+        A_vec = ov_A.reshape (dim_vector (ov_A.numel (), 1));
+    }
+
+  switch (code)
+    {
+      case attr_2d:
+        return A_ndims == 2;
+      case attr_3d:
+        return A_ndims <= 3;
+      case attr_column:
+        return A_ndims == 2 && A_dims(1) == 1;
+      case attr_row:
+        return A_ndims == 2 && A_dims(0) == 1;
+      case attr_real:
+        return ov_A.isreal ();
+      case attr_scalar:
+        return ov_A.numel () == 1;
+      case attr_square:
+        return A_ndims == 2 && A_dims(0) == A_dims(1);
+      case attr_size:
+        return match_size (A_dims, A_ndims, op.size);
+      case attr_vector:
+        return A_ndims == 2 && (A_dims(0) == 1 || A_dims(1) == 1);
+      case attr_diag:
+        return chk_diag (ov_A);
+      case attr_decreasing:
+        return chk_monotone (A_vec, op_lt);
+      case attr_nonempty:
+        return ! ov_A.isempty ();
+      case attr_nonsparse:
+        return ! ov_A.issparse ();
+      case attr_nonnan:
+        return ov_A.isinteger () || ! has_any (A_vec.isnan ());
+      case attr_nonnegative:
+        return ! has_any (A_vec < 0);
+      case attr_nonzero:
+        return ! has_any (A_vec == 0);
+      case attr_nondecreasing:
+        return chk_monotone (A_vec, op_ge);
+      case attr_nonincreasing:
+        return chk_monotone (A_vec, op_le);
+      case attr_numel:
+        return ov_A.numel () == attr_val.idx_type_value ();
+      case attr_ncols:
+        return A_ndims >= 2 && A_dims(1) == attr_val.idx_type_value ();
+      case attr_nrows:
+        return A_ndims >= 1 && A_dims(0) == attr_val.idx_type_value ();
+      case attr_ndims:
+        return A_ndims == attr_val.idx_type_value ();
+      case attr_binary:
+        return ov_A.islogical ()
+               || ! has_any (op_el_and ((A_vec != 1), (A_vec != 0)));
+      case attr_even:
+        return chk_even (A_vec);
+      case attr_odd:
+        return chk_odd (A_vec);
+      case attr_integer:
+        return ov_A.isinteger () || ! has_any (A_vec.ceil () != A_vec);
+      case attr_increasing:
+        return chk_monotone (A_vec, op_gt);
+      case attr_finite:
+        return ov_A.isinteger () || has_all (A_vec.isfinite ());
+      case attr_positive:
+        return ! has_any (A_vec <= 0);
+      case attr_gt:
+        return chk_compare (ov_A, attr_val, op_gt);
+      case attr_ge:
+        return chk_compare (ov_A, attr_val, op_ge);
+      case attr_lt:
+        return chk_compare (ov_A, attr_val, op_lt);
+      case attr_le:
+        return chk_compare (ov_A, attr_val, op_le);
+      case attr_realvalued:
+        return ov_A.isreal () || ! has_any (Fimag (A_vec)(0) != 0);
+      case attr_maxnnz:
+      case attr_maxcolnnz:
+      case attr_nostoredzeros:
+      case attr_sortedindices:
+        return chk_pattern (code, attr_val, ov_A, A_dims, idx);
+      case attr_castable:
+        return chk_castable (attr_val, ov_A, A_dims, idx);
+      default:
+        return false;
+    }
+}
+
+// Describe the element of A at linear index IDX, for the end of an error
+// message.  Empty if IDX is not known.
+static std::string
+violation_str (const octave_value& ov_A, octave_idx_type idx)
+{
+  if (idx < 0)
+    return "";
+
+  std::string val;
+  visit_array (ov_A, [&] (const auto *x)
+               {
+                 auto xi = x[idx];
+                 if constexpr (is_complex<decltype (xi)>::value)
+                   val = fmt_value (xi.real ())
+                         + (xi.imag () < 0 ? "-" : "+")
+                         + fmt_value (std::abs (xi.imag ())) + "i";
+                 else
+                   val = fmt_value (static_cast<double> (xi));
+               });
+
+  std::string str = " (first violation: element " + std::to_string (idx + 1);
+
+  dim_vector dv = ov_A.dims ();
+  if (! dv.is_nd_vector ())
+    {
+      str += ", subscript (";
+      octave_idx_type rem = idx;
+      for (int i = 0; i < dv.ndims (); i++)
+        {
+          if (i > 0)
+            str += ',';
+          str += std::to_string (rem % dv(i) + 1);
+          rem /= dv(i);
+        }
+      str += ')';
+    }
+
+  if (! val.empty ())
+    str += ", value " + val;
+
+  return str + ")";
+}
+
+// For an operand that is not a scalar, the message gives the bound that was
+// violated and where it applies, finding the first violation if the kernels
+// did not.
+template<typename O>
+static void
+err_compare (const std::string& tag, const std::string& cmp_str,
+             const std::string& err_ini, const octave_value& attr_val,
+             const octave_value& ov_A, octave_idx_type idx, O op)
+{
+  NDArray val = attr_val.array_value ();
+  std::string msg;
+
+  dim_vector A_dims = ov_A.dims ();
+  std::vector<std::ptrdiff_t> dims, bdims;
+
+  if (val.numel () == 1 || ! bcast_dims (A_dims, val.dims (), dims, bdims))
+    {
+      // sprintf repeats the template for each element of a non-scalar value
+      for (octave_idx_type i = 0; i < val.numel (); i++)
+        msg += err_ini + " must be " + cmp_str + " "
+               + fmt_value (val(i), "%f");
+
+      error_with_id (tag.c_str (), "%s%s", msg.c_str (),
+                     violation_str (ov_A, idx).c_str ());
+    }
+
+  if (idx < 0)
+    {
+      boolNDArray ok = op (ov_A, attr_val).bool_array_value ();
+      for (idx = 0; idx < ok.numel () && ok(idx); idx++)
+        ;
+    }
+
+  octave_idx_type b = bcast_index (dims.data (), bdims.data (), dims.size (),
+                                   idx);
+
+  msg = err_ini + " must be " + cmp_str + " " + fmt_value (val(b), "%f");
+
+  if (dims.size () == 2 && bdims[0] == 1)
+    msg += " in column " + std::to_string (idx / dims[0] + 1);
+  else if (dims.size () == 2 && bdims[1] == 1)
+    msg += " in row " + std::to_string (idx % dims[0] + 1);
+  else
+    msg += " at element " + std::to_string (b + 1) + " of the bound";
+
+  error_with_id (tag.c_str (), "%s%s", msg.c_str (),
+                 violation_str (ov_A, idx).c_str ());
+}
+
+static void
+err_attr (attr_code code, const std::string& name,
+          const octave_value& attr_val, const octave_value& ov_A,
+          const std::string& err_ini, octave_idx_type idx)
+{
+  std::string where = violation_str (ov_A, idx);
+
+  switch (code)
+    {
+      case attr_size:
+        err_size (ov_A, attr_val, err_ini);
+        break;
+      case attr_numel:
+        error_with_id ("Octave:incorrect-numel",
+                       "%s must have %s elements", err_ini.c_str (),
+                       std::to_string (attr_val.idx_type_value ()).c_str ());
+        break;
+      case attr_ncols:
+        error_with_id ("Octave:incorrect-numcols",
+                       "%s must have %s columns", err_ini.c_str (),
+                       std::to_string (attr_val.idx_type_value ()).c_str ());
+        break;
+      case attr_nrows:
+        error_with_id ("Octave:incorrect-numrows",
+                       "%s must have %s rows", err_ini.c_str (),
+                       std::to_string (attr_val.idx_type_value ()).c_str ());
+        break;
+      case attr_ndims:
+        error_with_id ("Octave:incorrect-numdims",
+                       "%s must have %s dimensions", err_ini.c_str (),
+                       std::to_string (attr_val.idx_type_value ()).c_str ());
+        break;
+      case attr_gt:
+        err_compare ("Octave:expected-greater", "greater than", err_ini,
+                     attr_val, ov_A, idx, op_gt);
+        break;
+      case attr_ge:
+        err_compare ("Octave:expected-greater-equal",
+                     "greater than or equal to", err_ini, attr_val, ov_A, idx,
+                     op_ge);
+        break;
+      case attr_lt:
+        err_compare ("Octave:expected-less", "less than", err_ini, attr_val,
+                     ov_A, idx, op_lt);
+        break;
+      case attr_le:
+        err_compare ("Octave:expected-less-equal", "less than or equal to",
+                     err_ini, attr_val, ov_A, idx, op_le);
+        break;
+      case attr_castable:
+        error_with_id ("Octave:expected-castable",
+                       "%s must convert to %s without loss%s",
+                       err_ini.c_str (), attr_val.string_value ().c_str (),
+                       where.c_str ());
+        break;
+      case attr_maxnnz:
+        error_with_id ("Octave:expected-maxnnz",
+                       "%s must have at most %s nonzero elements",
+                       err_ini.c_str (),
+                       std::to_string (attr_val.idx_type_value ()).c_str ());
+        break;
+      case attr_maxcolnnz:
+        error_with_id ("Octave:expected-maxcolnnz",
+                       "%s must have at most %s nonzero elements in each "
+                       "column%s", err_ini.c_str (),
+                       std::to_string (attr_val.idx_type_value ()).c_str (),
+                       where.c_str ());
+        break;
+      case attr_nostoredzeros:
+        error_with_id ("Octave:expected-nostoredzeros",
+                       "%s must not store zeros explicitly%s",
+                       err_ini.c_str (), where.c_str ());
+        break;
+      case attr_sortedindices:
+        error_with_id ("Octave:expected-sortedindices",
+                       "%s must have sorted row indices in each column%s",
+                       err_ini.c_str (), where.c_str ());
+        break;
+      default:
+        err_attr ("Octave:expected-" + std::string (attr_table[code].name),
+                  err_ini, name, where);
+    }
+}
+
+// Attributes are checked in stages of increasing cost, and in the order
+// given within each stage.
+enum check_stage
+{
+  stage_shape,      // class and dimensions of A only
+  stage_element,    // each element on its own, in one fused sweep if possible
+  stage_structural  // pairs of adjacent elements, or element positions
+};
+
+static const char *stage_names[] = { "shape", "element", "structural" };
+
+static check_stage
+attr_stage (attr_code code)
+{
+  switch (code)
+    {
+      case attr_diag:
+      case attr_decreasing:
+      case attr_nondecreasing:
+      case attr_nonincreasing:
+      case attr_increasing:
+      case attr_maxcolnnz:
+      case attr_nostoredzeros:
+      case attr_sortedindices:
+        return stage_structural;
+      default:
+        return (attr_table[code].kind == kind_value ? stage_element
+                                                    : stage_shape);
+    }
+}
+
+// What "locate" returns.
+enum locate_mode
+{
+  locate_none,
+  locate_mask,
+  locate_indices
+};
+
+static locate_mode
+locate_lookup (const octave_value& val)
+{
+  std::string mode = (val.is_string () ? val.string_value () : "");
+
+  if (mode == "mask")
+    return locate_mask;
+  else if (mode == "indices")
+    return locate_indices;
+  else
+    return locate_none;
+}
+
+struct attr_spec
+{
+  std::vector<attr_op> ops;  // in the order they are checked
+
+  // Elements checked by each value attribute, 0 to check all of them.
+  octave_idx_type      nsample = 0;
+
+  // Whether the value attributes are checked in the background.
+  bool                 async = false;
+
+  // Whether the violations are returned instead of raised.
+  bool                 collect = false;
+
+  // Whether the plan of the checks is returned instead of running them.
+  bool                 explain = false;
+
+  // How the elements that break the element-wise attributes are returned
+  // instead of raised, if they are.
+  locate_mode          locate = locate_none;
+
+  // Attributes that refer to another argument, see validateattributes_schema.
+  std::vector<attr_op> refs;
+};
+
+// Whether OP compares A with another argument: "sizeas", "classas", or a
+// count of dimensions whose value names the count of another argument.
+static bool
+is_ref (const attr_op& op)
+{
+  switch (op.code)
+    {
+      case attr_numel:
+      case attr_ncols:
+      case attr_nrows:
+      case attr_ndims:
+        return op.val.is_string ();
+      default:
+        return attr_table[op.code].kind == kind_ref;
+    }
+}
+
+// With ALLOW_REFS unset, attributes that refer to another argument are an
+// error, since there is none.
+static attr_spec
+parse_attributes (const Cell& attr, bool allow_refs = false)
+{
+  attr_spec       spec;
+  octave_idx_type i = 0;
+
+  while (i < attr.numel ())
+    {
+      attr_op op;
+      op.name = attr (i++).string_value ();
+      op.code = attr_lookup (op.name);
+
+      if (op.code == attr_unknown)
+        err_attr (op.name);
+
+      if (attr_table[op.code].has_value)
+        {
+          if (i == attr.numel ())
+            error ("Incorrect number of attribute cell arguments");
+          op.val = attr (i++);
+        }
+
+      if (op.code == attr_size && op.val.is_defined ())
+        op.size = parse_size (op.val);
+      else if ((op.code == attr_maxnnz || op.code == attr_maxcolnnz)
+               && ! (is_valid_idx (op.val) || (op.val.isnumeric ()
+                                               && op.val.numel () == 1
+                                               && op.val.scalar_value () == 0)))
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes: the value of %s must be a "
+                       "nonnegative integer", op.name.c_str ());
+      else if (op.code == attr_castable
+               && (! op.val.is_string ()
+                   || cast_lookup (op.val.string_value ()) == cast_unknown))
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes: the value of %s must name a "
+                       "numeric class or \"logical\"", op.name.c_str ());
+
+      if (is_ref (op))
+        {
+          if (! allow_refs)
+            error_with_id ("Octave:invalid-input-arg",
+                           "validateattributes: %s refers to another "
+                           "argument, which needs validateattributes_schema",
+                           op.name.c_str ());
+          spec.refs.push_back (op);
+        }
+      else if (op.code == attr_sample)
+        {
+          if (! is_valid_idx (op.val))
+            error_with_id ("Octave:invalid-input-arg",
+                           "validateattributes: SAMPLE must be a positive "
+                           "integer");
+          spec.nsample = op.val.idx_type_value ();
+        }
+      else if (op.code == attr_async)
+        spec.async = true;
+      else if (op.code == attr_collect)
+        spec.collect = true;
+      else if (op.code == attr_explain)
+        spec.explain = true;
+      else if (op.code == attr_locate)
+        {
+          spec.locate = locate_lookup (op.val);
+          if (spec.locate == locate_none)
+            error_with_id ("Octave:invalid-input-arg",
+                           "validateattributes: LOCATE must be \"mask\" or "
+                           "\"indices\"");
+        }
+      else
+        spec.ops.push_back (op);
+    }
+
+  std::stable_sort (spec.ops.begin (), spec.ops.end (),
+                    [] (const attr_op& a, const attr_op& b)
+                    { return attr_stage (a.code) < attr_stage (b.code); });
+
+  if (spec.async && spec.collect)
+    error_with_id ("Octave:invalid-input-arg",
+                   "validateattributes: \"async\" and \"collect\" cannot be "
+                   "combined");
+  else if (spec.locate != locate_none && (spec.async || spec.collect))
+    error_with_id ("Octave:invalid-input-arg",
+                   "validateattributes: \"locate\" cannot be combined with "
+                   "\"%s\"", spec.async ? "async" : "collect");
+
+  return spec;
+}
+
+// Process-wide settings, see set_option.  Each holds the index of its value
+// in the names of the option values.
+enum check_level
+{
+  level_off,
+  level_structural,
+  level_full
+};
+
+static int validation_level = level_full;
+
+// Whether the "sample" attribute is honoured.
+static int sampling_enabled = 1;
+
+// Whether successful checks are remembered, see cache_lookup.
+static int cache_enabled = 0;
+
+struct option_desc
+{
+  const char        *name;
+  const char *const *values;
+  int                nvalues;
+  int               *var;
+};
+
+static const char *const level_values[] = { "off", "structural", "full" };
+static const char *const on_off_values[] = { "off", "on" };
+
+static const option_desc option_table[] =
+{
+  { "cache",    on_off_values, 2, &cache_enabled    },
+  { "level",    level_values,  3, &validation_level },
+  { "sampling", on_off_values, 2, &sampling_enabled },
+};
+
+// Draw the elements checked by the value attributes: the first, the last,
+// and one at random from each of NSAMPLE equal strata of the rest.  Empty
+// if all elements are to be checked.
+static std::vector<std::ptrdiff_t>
+draw_sample (octave_idx_type numel, octave_idx_type nsample)
+{
+  static std::mt19937_64 rng (std::random_device {} ());
+
+  std::vector<std::ptrdiff_t> sample;
+
+  if (sampling_enabled && nsample > 0 && numel > nsample + 2)
+    {
+      sample.resize (nsample + 2);
+      sample.resize (sample_indices (numel, nsample, rng, sample.data ()));
+    }
+
+  return sample;
+}
+
+// Encode the checks in SPEC as KEY.  Return false if one of the values
+// can not be encoded.
+static bool
+spec_key (const attr_spec& spec, std::string& key)
+{
+  for (const attr_op& op : spec.ops)
+    {
+      if (op.code == attr_unknown)
+        return false;
+
+      key += static_cast<char> (op.code);
+
+      if (! attr_table[op.code].has_value)
+        continue;
+      else if (op.code == attr_castable)
+        {
+          key += static_cast<char> (cast_lookup (op.val.string_value ()));
+          continue;
+        }
+
+      if (! op.val.isnumeric () || ! op.val.isreal () || op.val.issparse ())
+        return false;
+
+      dim_vector dv = op.val.dims ();
+      octave_idx_type ndims = dv.ndims ();
+
+      key += static_cast<char> (op.val.builtin_type ());
+      key.append (reinterpret_cast<const char *> (&ndims), sizeof (ndims));
+      for (octave_idx_type i = 0; i < ndims; i++)
+        key.append (reinterpret_cast<const char *> (&dv(i)), sizeof (dv(i)));
+
+      // 64-bit integers in their own type, as a double may not hold them
+      if (op.val.is_int64_type ())
+        {
+          int64NDArray val = op.val.int64_array_value ();
+          key.append (reinterpret_cast<const char *> (val.data ()),
+                      val.numel () * sizeof (octave_int64));
+        }
+      else if (op.val.is_uint64_type ())
+        {
+          uint64NDArray val = op.val.uint64_array_value ();
+          key.append (reinterpret_cast<const char *> (val.data ()),
+                      val.numel () * sizeof (octave_uint64));
+        }
+      else
+        {
+          NDArray val = op.val.array_value ();
+          key.append (reinterpret_cast<const char *> (val.data ()),
+                      val.numel () * sizeof (double));
+        }
+    }
+
+  return true;
+}
+
+// Arrays that passed all checks of a spec, most recently used first.  Each
+// entry holds a reference to its array, so that the data can neither be
+// freed nor modified in place: Octave copies shared data before writing to
+// it, which moves any changed array to a new address.  That copy is the
+// cost of the cache: the first write to an element of a remembered array
+// copies all of it.  Entries nobody else refers to any more are dropped on
+// lookup and insertion, and all of them when the cache is turned off.
+struct cache_entry
+{
+  octave_value A;
+  void        *data;
+  std::string  spec;
+};
+
+static const std::size_t     cache_size      = 16;
+static const octave_idx_type cache_min_numel = 1024;
+
+static std::list<cache_entry> check_cache;
+
+// Return the data pointer under which A can be cached, or nullptr.
+static void *
+cache_data (const octave_value& ov_A)
+{
+  if (ov_A.numel () < cache_min_numel || ov_A.issparse ()
+      || ! (ov_A.isnumeric () || ov_A.islogical () || ov_A.is_string ()))
+    return nullptr;
+
+  return ov_A.mex_get_data ();
+}
+
+static bool
+cache_lookup (const octave_value& ov_A, void *data, const std::string& spec)
+{
+  for (auto it = check_cache.begin (); it != check_cache.end (); )
+    {
+      if (it->A.get_count () == 1)
+        it = check_cache.erase (it);
+      else if (it->data == data && it->spec == spec
+               && it->A.builtin_type () == ov_A.builtin_type ()
+               && it->A.dims () == ov_A.dims ())
+        {
+          check_cache.splice (check_cache.begin (), check_cache, it);
+          return true;
+        }
+      else
+        it++;
+    }
+
+  return false;
+}
+
+static void
+cache_insert (const octave_value& ov_A, void *data, const std::string& spec)
+{
+  check_cache.remove_if ([] (const cache_entry& e)
+                         { return e.A.get_count () == 1; });
+
+  check_cache.push_front (cache_entry {ov_A, data, spec});
+  if (check_cache.size () > cache_size)
+    check_cache.pop_back ();
+}
+
+struct check_result
+{
+  bool         sampled = false;   // some attribute was checked on a sample only
+  bool         cached  = false;   // the checks were skipped after a cache hit
+  octave_value summary;           // see make_summary, if asked for
+};
+
+// Violations returned by "collect" instead of being raised.
+struct violation
+{
+  std::string     attribute;
+  std::string     identifier;
+  std::string     message;
+  octave_idx_type idx;  // linear index of the first violation, or -1
+};
+
+struct violation_log
+{
+  octave::interpreter&   interp;
+  std::vector<violation> list;
+
+  // Record the error raised by RAISE, with the same identifier and message.
+  template <typename F>
+  void record (const std::string& attribute, octave_idx_type idx, F raise)
+  {
+    try
+      {
+        raise ();
+      }
+    catch (const octave::execution_exception& ee)
+      {
+        interp.recover_from_exception ();
+        list.push_back (violation {attribute, ee.identifier (),
+                                   ee.message (), idx});
+      }
+  }
+};
+
+// A struct array with the fields attribute, identifier, message, and
+// index, empty if the index is not known.
+static octave_value
+make_violations (const violation_log& log)
+{
+  dim_vector dv (1, log.list.size ());
+  Cell       attribute (dv), identifier (dv), message (dv), index (dv);
+
+  for (std::size_t i = 0; i < log.list.size (); i++)
+    {
+      const violation& v = log.list[i];
+      attribute(i)  = v.attribute;
+      identifier(i) = v.identifier;
+      message(i)    = v.message;
+      index(i)      = (v.idx >= 0 ? octave_value (v.idx + 1.0)
+                                  : octave_value (Matrix ()));
+    }
+
+  octave_map m (dv);
+  m.assign ("attribute", attribute);
+  m.assign ("identifier", identifier);
+  m.assign ("message", message);
+  m.assign ("index", index);
+  return m;
+}
+
+// Whether OP can be part of the sweep of fuse_attributes, which SCAN is
+// then set up for.  A must also be of a type visit_array handles.
+static bool
+is_fusable (const attr_op& op, const octave_value& ov_A,
+            const dim_vector& A_dims, native_scan& scan)
+{
+  return (attr_stage (op.code) == stage_element
+          && ! ov_A.is_diag_matrix () && ! ov_A.is_perm_matrix ()
+          && prepare_native (op.code, op.val, ov_A, A_dims, scan)
+          && scan.bounds.empty ());
+}
+
+// A value of the class min and max return for A, of builtin type BTYP.
+template <typename T>
+static octave_value
+summary_value (T v, builtin_type_t btyp)
+{
+  if constexpr (std::is_floating_point<T>::value)
+    return octave_value (v);
+  else if constexpr (std::is_same<T, bool>::value)
+    return octave_value (static_cast<double> (v));
+  else if (btyp == btyp_char)
+    return octave_value (static_cast<double> (v));
+  else
+    return octave_value (octave_int<T> (v));
+}
+
+// The SUMMARY output of validateattributes.  Without S, or where S does not
+// know them, the fields are empty.
+template <typename T = double>
+static octave_value
+make_summary (const value_summary<T> *s = nullptr,
+              builtin_type_t btyp = btyp_double)
+{
+  octave_value empty = Matrix ();
+  octave_value min = empty, max = empty, nnan = empty, ninf = empty,
+               nzero = empty, nondecreasing = empty, nonincreasing = empty;
+
+  if (s)
+    {
+      nnan  = static_cast<double> (s->nnan);
+      ninf  = static_cast<double> (s->ninf);
+      nzero = static_cast<double> (s->nzero);
+
+      if constexpr (! is_complex<T>::value)
+        {
+          if (s->numel > s->nnan)
+            {
+              min = summary_value (s->min, btyp);
+              max = summary_value (s->max, btyp);
+            }
+          nondecreasing = s->nondecreasing;
+          nonincreasing = s->nonincreasing;
+        }
+    }
+
+  octave_scalar_map m;
+  m.assign ("min", min);
+  m.assign ("max", max);
+  m.assign ("nnan", nnan);
+  m.assign ("ninf", ninf);
+  m.assign ("nzero", nzero);
+  m.assign ("nondecreasing", nondecreasing);
+  m.assign ("nonincreasing", nonincreasing);
+  return m;
+}
+
+// Run the attributes of the element stage of SPEC that the kernels handle
+// together, in one sweep over A, see scan_fused for ALL.  Returns for each
+// of SPEC.ops the linear index of its first violation, -1 if there is none,
+// or -2 if it was not part of the sweep.  With SUMMARY, the sweep is made
+// even for a single attribute, or none, and SUMMARY is set from it.  The
+// sweep is timed as a whole, in the "fused" phase of PROF and in the
+// stats_fused_row of the counters, since its attributes cannot be told
+// apart within it.
+static std::vector<octave_idx_type>
+fuse_attributes (const attr_spec& spec, const octave_value& ov_A,
+                 const dim_vector& A_dims, bool all, octave::profiler& prof,
+                 octave_value *summary = nullptr)
+{
+  std::vector<octave_idx_type> res (spec.ops.size (), -2);
+
+  std::vector<attr_code>   codes;
+  std::vector<double>      bounds;
+  std::vector<std::size_t> which;
+
+  for (std::size_t k = 0; k < spec.ops.size (); k++)
+    {
+      native_scan scan;
+
+      if (! is_fusable (spec.ops[k], ov_A, A_dims, scan))
+        continue;
+
+      codes.push_back (spec.ops[k].code);
+      bounds.push_back (scan.bound);
+      which.push_back (k);
+    }
+
+  if (codes.size () < 2 && ! summary)
+    return res;
+
+  std::vector<std::ptrdiff_t> idx (codes.size ());
+  octave_idx_type nr = A_dims(0);
+  octave_idx_type nc = (nr > 0 ? A_dims.numel () / nr : 0);
+
+  if (visit_array (ov_A, [&] (const auto *x)
+                   {
+                     using T = std::remove_const_t<
+                                 std::remove_pointer_t<decltype (x)>>;
+                     value_summary<T> sum;
+
+                     stats_probe   probe (stats_fused_row,
+                                          ov_A.builtin_type (),
+                                          A_dims.numel ());
+                     profile_block block (prof, profile_phase ("fused"));
+
+                     scan_fused (codes.data (), bounds.data (), codes.size (),
+                                 x, nr, nc, idx.data (), all,
+                                 summary ? &sum : nullptr);
+                     if (std::any_of (idx.begin (), idx.end (),
+                                      [] (std::ptrdiff_t i) { return i >= 0; }))
+                       probe.fail ();
+                     if (summary)
+                       *summary = make_summary (&sum, ov_A.builtin_type ());
+                   }))
+    {
+      for (std::size_t i = 0; i < which.size (); i++)
+        res[which[i]] = idx[i];
+    }
+
+  return res;
+}
+
+// The elements that "locate" found in A.  With "mask" they are set in a
+// mask shaped like A, otherwise their linear indices are collected, in any
+// order and with repeats, so that only "mask" allocates an array the size
+// of A.
+struct location_set
+{
+  locate_mode                  mode;
+  boolNDArray                  mask;
+  std::vector<octave_idx_type> idx;
+
+  location_set (locate_mode m = locate_none,
+                const dim_vector& A_dims = dim_vector ())
+    : mode (m)
+  {
+    if (mode == locate_mask)
+      mask = boolNDArray (A_dims, false);
+  }
+
+  void mark (octave_idx_type i)
+  {
+    if (mode == locate_mask)
+      mask.xelem (i) = true;
+    else
+      idx.push_back (i);
+  }
+};
+
+// "locate": mark in LOC the elements of A that break the attributes of the
+// element stage.  Those the kernels handle are marked in a single sweep
+// over the stored values: all of a full A, the stored elements of a sparse
+// one, the diagonal of a diagonal matrix, or the ones of a permutation
+// matrix.  The other elements of those are zero, and are all marked if
+// zero breaks an attribute.  Comparisons against an operand that is not a
+// scalar by the operator.  Returns which of SPEC.ops were marked.
+static std::vector<bool>
+mark_attributes (const attr_spec& spec, const octave_value& ov_A,
+                 const dim_vector& A_dims, location_set& loc)
+{
+  std::vector<bool> marked (spec.ops.size ());
+
+  if (! ov_A.issparse () && ! ov_A.is_diag_matrix ()
+      && ! ov_A.is_perm_matrix () && ! visit_array (ov_A, [] (const auto *) { }))
+    return marked;
+
+  std::vector<attr_code>   codes;
+  std::vector<double>      bounds;
+  std::vector<std::size_t> which;
+
+  for (std::size_t k = 0; k < spec.ops.size (); k++)
+    {
+      const attr_op& op = spec.ops[k];
+      native_scan    scan;
+
+      if (attr_stage (op.code) != stage_element
+          || ! prepare_native (op.code, op.val, ov_A, A_dims, scan))
+        continue;
+      else if (scan.bounds.empty ())
+        {
+          codes.push_back (op.code);
+          bounds.push_back (scan.bound);
+          which.push_back (k);
+          continue;
+        }
+
+      octave_value ok;
+      switch (op.code)
+        {
+          case attr_gt:
+            ok = op_gt (ov_A, op.val);
+            break;
+          case attr_ge:
+            ok = op_ge (ov_A, op.val);
+            break;
+          case attr_lt:
+            ok = op_lt (ov_A, op.val);
+            break;
+          default:
+            ok = op_le (ov_A, op.val);
+        }
+
+      boolNDArray b = ok.bool_array_value ();
+      for (octave_idx_type i = 0; i < b.numel (); i++)
+        {
+          if (! b(i))
+            loc.mark (i);
+        }
+      marked[k] = true;
+    }
+
+  for (std::size_t k : which)
+    marked[k] = true;
+
+  if (codes.empty ())
+    return marked;
+
+  // the stored values X, N of them, where element I is at INDEX (I) of A
+  auto stored = [&] (const auto *x, std::ptrdiff_t n, auto index)
+    {
+      mark_fused (codes.data (), bounds.data (), codes.size (), x, n,
+                  [&] (std::ptrdiff_t i) { loc.mark (index (i)); });
+    };
+
+  // whether ZERO breaks any of the attributes
+  auto zero_breaks = [&] (auto zero)
+    {
+      for (std::size_t k = 0; k < codes.size (); k++)
+        {
+          if (scan_attr (codes[k], &zero, 1, 1, bounds[k]) >= 0)
+            return true;
+        }
+      return false;
+    };
+
+  octave_idx_type nr = A_dims(0);
+  octave_idx_type nc = (nr > 0 ? A_dims.numel () / nr : A_dims(1));
+
+  if (ov_A.is_perm_matrix ())
+    {
+      PermMatrix             pm = ov_A.perm_matrix_value ();
+      const octave_idx_type *p = pm.col_perm_vec ().data ();
+
+      bool one = zero_breaks (1.0);
+      bool zero = zero_breaks (0.0);
+
+      for (octave_idx_type j = 0; j < nc; j++)
+        {
+          if (one)
+            loc.mark (j * nr + p[j]);
+          for (octave_idx_type i = 0; zero && i < nr; i++)
+            {
+              if (i != p[j])
+                loc.mark (j * nr + i);
+            }
+        }
+    }
+  else if (ov_A.issparse ())
+    visit_sparse (ov_A, [&] (const auto *data, const octave_idx_type *cidx,
+                             const octave_idx_type *ridx)
+                  {
+                    using T = std::remove_const_t<
+                                std::remove_pointer_t<decltype (data)>>;
+
+                    stored (data, cidx[nc], [=] (std::ptrdiff_t k)
+                            { return sparse_index (cidx, ridx, nr, nc, k); });
+
+                    if (! zero_breaks (T (0)))
+                      return;
+
+                    for (octave_idx_type j = 0; j < nc; j++)
+                      {
+                        octave_idx_type k = cidx[j];
+                        for (octave_idx_type i = 0; i < nr; i++)
+                          {
+                            if (k < cidx[j+1] && ridx[k] == i)
+                              k++;
+                            else
+                              loc.mark (j * nr + i);
+                          }
+                      }
+                  });
+  else if (ov_A.is_diag_matrix ())
+    visit_diag (ov_A, [&] (const auto *d)
+                {
+                  using T = std::remove_const_t<
+                              std::remove_pointer_t<decltype (d)>>;
+
+                  stored (d, std::min (nr, nc), [=] (std::ptrdiff_t i)
+                          { return i * (nr + 1); });
+
+                  if (! zero_breaks (T (0)))
+                    return;
+
+                  for (octave_idx_type j = 0; j < nc; j++)
+                    {
+                      for (octave_idx_type i = 0; i < nr; i++)
+                        {
+                          if (i != j)
+                            loc.mark (j * nr + i);
+                        }
+                    }
+                });
+  else
+    visit_array (ov_A, [&] (const auto *x)
+                 {
+                   stored (x, A_dims.numel (), [] (std::ptrdiff_t i)
+                           { return i; });
+                 });
+
+  return marked;
+}
+
+// The output of "locate" for LOC.
+static octave_value
+make_locations (location_set& loc)
+{
+  if (loc.mode == locate_mask)
+    return octave_value (loc.mask);
+
+  std::sort (loc.idx.begin (), loc.idx.end ());
+  loc.idx.erase (std::unique (loc.idx.begin (), loc.idx.end ()),
+                 loc.idx.end ());
+
+  NDArray idx (dim_vector (loc.idx.size (), 1));
+  double *p = idx.fortran_vec ();
+  for (octave_idx_type i : loc.idx)
+    *p++ = i + 1;
+
+  return octave_value (idx);
+}
+
+// The attributes of the element stage that the kernels handle are checked
+// in a single sweep over A.  With LOG, the failures are recorded in it
+// rather than raised.  With SUMMARIZE, the summary of all of A is made in
+// the same sweep.  With LOC, the attributes of the element stage mark the
+// elements that break them in LOC instead, see mark_attributes, and only
+// those that could not be marked fail.
+static check_result
+chk_attributes (const octave_value& ov_A, const attr_spec& spec,
+                const std::string& err_ini, octave::profiler& prof,
+                violation_log *log = nullptr, bool summarize = false,
+                location_set *loc = nullptr)
+{
+
+  bool            ok;
+  bool            sampled;
+  octave_idx_type idx;
+  check_result    result;
+
+  octave_value    A_vec;
+  dim_vector      A_dims  = ov_A.dims ();
+  octave_idx_type A_ndims = ov_A.ndims ();
+  octave_idx_type A_numel = ov_A.numel ();
+  builtin_type_t  A_btyp  = ov_A.builtin_type ();
+
+  void           *A_data = nullptr;
+  std::string     key;
+
+  if (! cache_enabled)
+    check_cache.clear ();
+  else if (! loc && (A_data = cache_data (ov_A)) && spec_key (spec, key))
+    {
+      if (cache_lookup (ov_A, A_data, key))
+        {
+          result.cached = true;
+          if (summarize)
+            fuse_attributes (attr_spec (), ov_A, A_dims, true, prof,
+                             &result.summary);
+          return result;
+        }
+    }
+  else
+    A_data = nullptr;
+
+  std::vector<std::ptrdiff_t> sample = draw_sample (A_numel, spec.nsample);
+
+  octave_value *summary = (summarize ? &result.summary : nullptr);
+
+  std::vector<bool> marked;
+  if (loc)
+    {
+      *loc = location_set (spec.locate, A_dims);
+      if (validation_level == level_full)
+        marked = mark_attributes (spec, ov_A, A_dims, *loc);
+    }
+
+  std::vector<octave_idx_type> fused;
+  if (sample.empty () && validation_level == level_full && ! loc)
+    fused = fuse_attributes (spec, ov_A, A_dims, log != nullptr, prof,
+                             summary);
+  else if (summary)
+    fuse_attributes (attr_spec (), ov_A, A_dims, true, prof, summary);
+
+  for (std::size_t k = 0; k < spec.ops.size (); k++)
+    {
+      const attr_op& op = spec.ops[k];
+
+      if ((validation_level == level_structural
+           && attr_table[op.code].kind == kind_value)
+          || (! marked.empty () && marked[k]))
+        continue;
+
+      stats_probe probe (op.code, A_btyp,
+                         attr_table[op.code].kind == kind_value ? A_numel : 0);
+
+      if (! fused.empty () && fused[k] != -2)
+        {
+          idx = fused[k];
+          ok = (idx < 0);
+          sampled = false;
+        }
+      else
+        {
+          profile_block block (prof, profile_phase (attr_table[op.code].name));
+          ok = chk_attr (op, ov_A, A_vec, A_dims, A_ndims, sample, sampled,
+                         idx);
+        }
+
+      if (sampled)
+        {
+          probe.set_elements (sample.size ());
+          result.sampled = true;
+        }
+
+      if (! ok)
+        {
+          probe.fail ();
+          profile_block block (prof, profile_phase ("error"));
+          if (log)
+            log->record (op.name, idx, [&] ()
+                         {
+                           err_attr (op.code, op.name, op.val, ov_A, err_ini,
+                                     idx);
+                         });
+          else
+            err_attr (op.code, op.name, op.val, ov_A, err_ini, idx);
+        }
+    }
+
+  if (A_data && ! result.sampled && validation_level == level_full
+      && (! log || log->list.empty ()))
+    cache_insert (ov_A, A_data, key);
+
+  return result;
+}
+
+static octave_value
+make_info (const check_result& result)
+{
+  octave_scalar_map info;
+  info.assign ("sampled", result.sampled);
+  info.assign ("cached", result.cached);
+  return info;
+}
+
+// The plan of "explain": a struct array with the attribute, stage, and
+// method of each check, in the order they would be made.
+static octave_value
+make_plan (const octave_value& ov_A, const Array<std::string>& cls,
+           const attr_spec& spec)
+{
+  std::vector<std::string> attribute, stage, method;
+
+  if (! cls.isempty ())
+    {
+      attribute.push_back ("(classes)");
+      stage.push_back ("classes");
+      method.push_back ("direct");
+    }
+
+  dim_vector A_dims  = ov_A.dims ();
+  bool       native  = visit_array (ov_A, [] (const auto *) { });
+  bool       sampled = (sampling_enabled && spec.nsample > 0
+                        && ov_A.numel () > spec.nsample + 2);
+  bool       implicit = ov_A.is_diag_matrix () || ov_A.is_perm_matrix ();
+
+  std::vector<bool> fused (spec.ops.size ());
+  std::size_t       nfused = 0;
+  native_scan       scan;
+
+  for (std::size_t k = 0; k < spec.ops.size () && native && ! sampled; k++)
+    nfused += (fused[k] = is_fusable (spec.ops[k], ov_A, A_dims, scan));
+
+  for (std::size_t k = 0; k < spec.ops.size (); k++)
+    {
+      const attr_op& op = spec.ops[k];
+      check_stage    st = attr_stage (op.code);
+      const char    *how;
+
+      if (st == stage_shape)
+        how = "direct";
+      else if (attr_table[op.code].kind == kind_pattern)
+        how = (ov_A.issparse () ? "pattern" : "generic");
+      else if (validation_level != level_full)
+        how = "skipped";
+      else if (fused[k] && nfused > 1)
+        how = "fused";
+      else if (! prepare_native (op.code, op.val, ov_A, A_dims, scan))
+        how = "generic";
+      else if (implicit)
+        how = (scan.bounds.empty () ? "implicit" : "generic");
+      else if (native)
+        how = (sampled && scan.bounds.empty () ? "sampled" : "kernel");
+      else
+        how = "generic";
+
+      attribute.push_back (op.name);
+      stage.push_back (stage_names[st]);
+      method.push_back (how);
+    }
+
+  dim_vector dv (1, attribute.size ());
+  Cell       c_attribute (dv), c_stage (dv), c_method (dv);
+
+  for (std::size_t i = 0; i < attribute.size (); i++)
+    {
+      c_attribute(i) = attribute[i];
+      c_stage(i)     = stage[i];
+      c_method(i)    = method[i];
+    }
+
+  octave_map m (dv);
+  m.assign ("attribute", c_attribute);
+  m.assign ("stage", c_stage);
+  m.assign ("method", c_method);
+  return m;
+}
+
+// Asynchronous validation, see validateattributes_wait.  The value
+// attributes that the kernels handle run on a thread of their own, which
+// never uses the interpreter.  The other checks are done at once, but their
+// errors, like those of the thread, are only raised by
+// validateattributes_wait, in the same order as without "async".  The job
+// holds a reference to A, so that Octave copies the data before any change
+// to A and the thread keeps reading the original.  Nothing tells when a
+// token is dropped without being waited for, so at most async_max_jobs jobs
+// are pending, and no new one starts until some are waited for.  Discarding
+// one instead would lose its errors, and block on its thread.  Those still
+// pending are discarded, once their threads end, when the module is
+// unloaded.
+
+struct async_job
+{
+  octave_value                 ov_A;
+  std::string                  err_ini;
+  Array<std::string>           cls;
+  bool                         cls_ok = true;
+  std::vector<attr_op>         ops;
+  std::vector<char>            ok;   // result of each of OPS
+  std::vector<octave_idx_type> idx;  // first violation for each of OPS
+  std::future<void>            done;
+};
+
+static std::map<double, std::unique_ptr<async_job>> async_jobs;
+
+static const std::size_t async_max_jobs = 256;
+
+static double async_last_token = 0;
+
+// Token of the jobs with nothing left to check, as when the level is off.
+static const double async_done_token = 0;
+
+static double
+start_async (const octave_value& ov_A, const Array<std::string>& cls,
+             const attr_spec& spec, const std::string& err_ini)
+{
+  struct queued
+  {
+    std::size_t pos;
+    native_scan scan;
+  };
+
+  if (async_jobs.size () >= async_max_jobs)
+    error ("validateattributes: %d \"async\" checks are pending, wait for "
+           "them with validateattributes_wait", int (async_max_jobs));
+
+  std::unique_ptr<async_job> job (new async_job);
+  async_job *j = job.get ();
+
+  j->ov_A    = ov_A;
+  j->err_ini = err_ini;
+  j->cls     = cls;
+  j->cls_ok  = cls.isempty () || chk_class (ov_A, cls);
+  j->ops     = spec.ops;
+  j->ok.assign (spec.ops.size (), true);
+  j->idx.assign (spec.ops.size (), -1);
+
+  octave_value    A_vec;
+  dim_vector      A_dims  = ov_A.dims ();
+  octave_idx_type A_ndims = ov_A.ndims ();
+  builtin_type_t  A_btyp  = ov_A.builtin_type ();
+
+  void *A_data = nullptr;
+  if (! ov_A.issparse () && ! ov_A.is_diag_matrix ()
+      && ! ov_A.is_perm_matrix ())
+    A_data = ov_A.mex_get_data ();
+
+  std::vector<std::ptrdiff_t> sample = draw_sample (ov_A.numel (),
+                                                    spec.nsample);
+
+  // checks done here stop at the first failure, after which nothing else
+  // matters
+  std::vector<queued> queue;
+  std::size_t         stop = j->ops.size ();
+  bool                sampled;
+
+  for (std::size_t i = 0; i < stop; i++)
+    {
+      const attr_op& op = j->ops[i];
+
+      if (validation_level == level_structural
+          && attr_table[op.code].kind == kind_value)
+        continue;
+
+      native_scan scan;
+
+      if (attr_table[op.code].kind == kind_value && A_data
+          && prepare_native (op.code, op.val, ov_A, A_dims, scan))
+        queue.push_back ({i, scan});
+      else if (! (j->ok[i] = chk_attr (op, ov_A, A_vec, A_dims, A_ndims,
+                                       sample, sampled, j->idx[i])))
+        stop = i;
+    }
+
+  auto run = [j, A_btyp, A_data, stop, queue = std::move (queue),
+              sample = std::move (sample)] ()
+    {
+      bool sampled;
+
+      for (const queued& q : queue)
+        {
+          if (q.pos >= stop)
+            break;
+
+          visit_data (A_btyp, A_data, [&] (const auto *x)
+                      { j->idx[q.pos] = run_native (q.scan, x, sample,
+                                                    sampled); });
+
+          if (j->idx[q.pos] >= 0)
+            {
+              j->ok[q.pos] = false;
+              break;
+            }
+        }
+    };
+
+  try
+    {
+      j->done = std::async (std::launch::async, run);
+    }
+  catch (const std::system_error&)
+    {
+      // no thread to be had, check when waited for
+      j->done = std::async (std::launch::deferred, run);
+    }
+
+  async_jobs[++async_last_token] = std::move (job);
+
+  return async_last_token;
+}
+
+// Whether ATTRIBUTES holds the pseudo-attribute CODE, without parsing it.
+// VAL, if given, is set to the element after it.
+static bool
+has_option (const octave_value& ov_attr, attr_code code,
+            octave_value *val = nullptr)
+{
+  if (! ov_attr.iscell ())
+    return false;
+
+  Cell attr = ov_attr.cell_value ();
+  for (octave_idx_type i = 0; i < attr.numel (); i++)
+    {
+      if (attr(i).is_string ()
+          && attr_lookup (attr(i).string_value ()) == code)
+        {
+          if (val && i + 1 < attr.numel ())
+            *val = attr(i+1);
+          return true;
+        }
+    }
+  return false;
+}
+
+// Raise the first error found by JOB, if any.
+static void
+finish_async (async_job& job)
+{
+  job.done.wait ();
+
+  if (! job.cls_ok)
+    cls_error (job.err_ini, job.cls, job.ov_A.class_name ());
+
+  for (std::size_t i = 0; i < job.ops.size (); i++)
+    {
+      const attr_op& op = job.ops[i];
+      if (! job.ok[i])
+        err_attr (op.code, op.name, op.val, job.ov_A, job.err_ini,
+                  job.idx[i]);
+    }
+}
+
+// Columnar validation, see validateattributes_columns.  The checks that
+// need the interpreter are made first, a column at a time.  The value
+// attributes that the kernels handle are then cut into tasks, large columns
+// into chunks of column_chunk elements, which run on a pool of threads.
+// The first column to fail is the one reported, so once a column fails the
+// tasks of the columns after it are dropped.
+
+static const std::ptrdiff_t column_chunk = 1 << 20;
+
+struct column_check
+{
+  octave_value                 ov_A;
+  std::string                  err_ini;
+  Array<std::string>           cls;
+  attr_spec                    spec;
+  bool                         cls_ok = true;
+  builtin_type_t               btyp;
+  void                        *data = nullptr;
+  std::vector<std::ptrdiff_t>  sample;
+
+  // checked a chunk at a time: the element-wise attributes with a scalar
+  // operand, in one sweep, and then the monotonic ones
+  std::vector<std::size_t>     fused;
+  std::vector<attr_code>       fused_codes;
+  std::vector<double>          fused_bounds;
+  std::vector<std::size_t>     monotone;
+
+  // checked in one go, over the whole column
+  std::vector<std::size_t>     whole;
+  std::vector<native_scan>     whole_scans;
+
+  std::vector<octave_idx_type> idx;  // first violation of each of SPEC.ops
+
+  // whether the last of SPEC.ops failed the checks made here
+  bool                         failed = false;
+};
+
+struct column_task
+{
+  std::size_t                 col;
+  std::ptrdiff_t              lo;
+  std::ptrdiff_t              hi;
+  std::ptrdiff_t              whole;  // of the column's WHOLE, or -1
+  std::vector<std::ptrdiff_t> idx;    // first violation of each check
+};
+
+// Run RUN on the tasks 0 to NTASKS-1, on this thread and at most NTHREADS-1
+// others.  The tasks are dealt out to a deque for each thread, which takes
+// them from the front, the first columns first.  A thread whose deque is
+// empty steals from the back of the others, so the small tasks left at the
+// end go to whoever is idle.
+template <typename F>
+static void
+run_stealing (std::size_t ntasks, std::size_t nthreads, F run)
+{
+  struct task_deque
+  {
+    std::mutex              lock;
+    std::deque<std::size_t> tasks;
+  };
+
+  nthreads = std::max<std::size_t> (1, std::min (nthreads, ntasks));
+
+  std::vector<task_deque> deques (nthreads);
+  for (std::size_t t = 0; t < ntasks; t++)
+    deques[t % nthreads].tasks.push_back (t);
+
+  auto work = [&deques, &run, nthreads] (std::size_t self)
+    {
+      for (;;)
+        {
+          std::size_t t = 0;
+          bool        found = false;
+
+          for (std::size_t k = 0; k < nthreads && ! found; k++)
+            {
+              task_deque& d = deques[(self + k) % nthreads];
+              std::lock_guard<std::mutex> guard (d.lock);
+
+              if (d.tasks.empty ())
+                continue;
+
+              found = true;
+              if (k == 0)
+                {
+                  t = d.tasks.front ();
+                  d.tasks.pop_front ();
+                }
+              else
+                {
+                  t = d.tasks.back ();
+                  d.tasks.pop_back ();
+                }
+            }
+
+          // tasks never make new ones, so there is nothing left
+          if (! found)
+            return;
+
+          run (t);
+        }
+    };
+
+  std::vector<std::thread> threads;
+  for (std::size_t k = 1; k < nthreads; k++)
+    {
+      try
+        {
+          threads.emplace_back (work, k);
+        }
+      catch (const std::system_error&)
+        {
+          // the threads there are steal the tasks of those missing
+          break;
+        }
+    }
+
+  work (0);
+
+  for (std::thread& th : threads)
+    th.join ();
+}
+
+// Make the checks of column CK that need the interpreter, and set up the
+// others.  Return false if one of them fails.
+static bool
+prepare_column (column_check& ck)
+{
+  const std::vector<attr_op>& ops = ck.spec.ops;
+
+  ck.idx.assign (ops.size (), -1);
+  ck.cls_ok = ck.cls.isempty () || chk_class (ck.ov_A, ck.cls);
+  if (! ck.cls_ok)
+    return false;
+
+  octave_value    A_vec;
+  dim_vector      A_dims  = ck.ov_A.dims ();
+  octave_idx_type A_ndims = ck.ov_A.ndims ();
+  bool            sampled;
+
+  ck.btyp = ck.ov_A.builtin_type ();
+  if (! ck.ov_A.issparse () && ! ck.ov_A.is_diag_matrix ()
+      && ! ck.ov_A.is_perm_matrix ())
+    ck.data = ck.ov_A.mex_get_data ();
+
+  ck.sample = draw_sample (ck.ov_A.numel (), ck.spec.nsample);
+
+  for (std::size_t k = 0; k < ops.size (); k++)
+    {
+      const attr_op& op = ops[k];
+      native_scan    scan;
+
+      if (validation_level == level_structural
+          && attr_table[op.code].kind == kind_value)
+        continue;
+
+      if (attr_table[op.code].kind != kind_value || ! ck.data
+          || ! prepare_native (op.code, op.val, ck.ov_A, A_dims, scan))
+        {
+          if (! chk_attr (op, ck.ov_A, A_vec, A_dims, A_ndims, ck.sample,
+                          sampled, ck.idx[k]))
+            {
+              // the later ones cannot be the first failure
+              ck.spec.ops.resize (k + 1);
+              ck.failed = true;
+              return false;
+            }
+        }
+      else if (! ck.sample.empty () || ! scan.bounds.empty ()
+               || op.code == attr_diag)
+        {
+          ck.whole.push_back (k);
+          ck.whole_scans.push_back (scan);
+        }
+      else if (attr_stage (op.code) == stage_element)
+        {
+          ck.fused.push_back (k);
+          ck.fused_codes.push_back (op.code);
+          ck.fused_bounds.push_back (scan.bound);
+        }
+      else
+        ck.monotone.push_back (k);
+    }
+
+  return true;
+}
+
+// Run TASK of column CK, setting TASK.idx to the first violation of each
+// of its checks, and return whether there is any.
+static bool
+run_column_task (const column_check& ck, column_task& task)
+{
+  bool failed = false;
+
+  visit_data (ck.btyp, ck.data, [&] (const auto *x)
+    {
+      if (task.whole >= 0)
+        {
+          bool sampled;
+          task.idx.assign (1, run_native (ck.whole_scans[task.whole], x,
+                                          ck.sample, sampled));
+          failed = task.idx[0] >= 0;
+          return;
+        }
+
+      std::size_t    nfused = ck.fused.size ();
+      std::ptrdiff_t lo = task.lo;
+      std::ptrdiff_t n = task.hi - lo;
+
+      task.idx.assign (nfused + ck.monotone.size (), -1);
+
+      if (nfused > 0)
+        {
+          scan_fused (ck.fused_codes.data (), ck.fused_bounds.data (), nfused,
+                      x + lo, n, 1, task.idx.data (), false);
+
+          for (std::size_t i = 0; i < nfused; i++)
+            {
+              if (task.idx[i] >= 0)
+                {
+                  task.idx[i] += lo;
+                  failed = true;
+                }
+            }
+        }
+
+      // the pair across the start of the chunk belongs to it
+      for (std::size_t i = 0; i < ck.monotone.size () && ! failed; i++)
+        {
+          std::ptrdiff_t r;
+          attr_code      code = ck.spec.ops[ck.monotone[i]].code;
+
+          if (lo == 0)
+            r = scan_attr (code, x, n, 1, 0.0);
+          else if ((r = scan_attr (code, x + lo - 1, n + 1, 1, 0.0)) >= 0)
+            r += lo - 1;
+
+          task.idx[nfused + i] = r;
+          failed = r >= 0;
+        }
+    });
+
+  return failed;
+}
+
+// Raise the error of the first column of COLS that failed, if any.
+static void
+finish_columns (std::vector<column_check>& cols,
+                const std::vector<column_task>& tasks)
+{
+  auto merge = [] (octave_idx_type& idx, std::ptrdiff_t r)
+    {
+      if (r >= 0 && (idx < 0 || r < idx))
+        idx = r;
+    };
+
+  for (const column_task& task : tasks)
+    {
+      column_check& ck = cols[task.col];
+
+      if (task.idx.empty ())
+        continue;
+      else if (task.whole >= 0)
+        merge (ck.idx[ck.whole[task.whole]], task.idx[0]);
+      else
+        {
+          for (std::size_t i = 0; i < ck.fused.size (); i++)
+            merge (ck.idx[ck.fused[i]], task.idx[i]);
+          for (std::size_t i = 0; i < ck.monotone.size (); i++)
+            merge (ck.idx[ck.monotone[i]], task.idx[ck.fused.size () + i]);
+        }
+    }
+
+  for (column_check& ck : cols)
+    {
+      if (! ck.cls_ok)
+        cls_error (ck.err_ini, ck.cls, ck.ov_A.class_name ());
+
+      for (std::size_t k = 0; k < ck.spec.ops.size (); k++)
+        {
+          const attr_op& op = ck.spec.ops[k];
+          if (ck.idx[k] >= 0 || (ck.failed && k + 1 == ck.spec.ops.size ()))
+            err_attr (op.code, op.name, op.val, ck.ov_A, ck.err_ini,
+                      ck.idx[k]);
+        }
+    }
+}
+
+// The entry of option_table named OPTION, or nullptr.
+static const option_desc *
+find_option (const std::string& option)
+{
+  for (const option_desc& o : option_table)
+    {
+      if (option == o.name)
+        return &o;
+    }
+  return nullptr;
+}
+
+// validateattributes (OPTION, VALUE): process-wide settings.  OPTION must
+// be one of option_table.
+static octave_value_list
+set_option (octave::interpreter& interp, const octave_value_list& args,
+            int nargout)
+{
+  octave_idx_type nargin = args.length ();
+  std::string     option = args(0).string_value ();
+
+  if (nargin > 3 || (nargin == 3 && args(2).string_value () != "local"))
+    print_usage ();
+
+  const option_desc *opt = find_option (option);
+
+  octave_value retval = opt->values[*opt->var];
+
+  if (nargin > 1)
+    {
+      std::string value = args(1).string_value ();
+
+      int new_val = 0;
+      while (new_val < opt->nvalues && value != opt->values[new_val])
+        new_val++;
+
+      if (new_val == opt->nvalues)
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes: invalid value \"%s\" for %s",
+                       value.c_str (), option.c_str ());
+
+      if (nargin == 3)
+        {
+          octave::unwind_protect *frame
+            = interp.get_evaluator ().curr_fcn_unwind_protect_frame ();
+
+          if (frame)
+            frame->protect_var (*opt->var);
+          else
+            warning ("validateattributes: \"local\" has no effect outside "
+                     "a function");
+        }
+
+      *opt->var = new_val;
+
+      // let go of the arrays at once, not on the next check
+      if (opt->var == &cache_enabled && ! cache_enabled)
+        check_cache.clear ();
+    }
+
+  if (nargin == 1 || nargout > 0)
+    return octave_value_list (retval);
+
+  return octave_value_list ();
+}
+
+DEFMETHOD_DLD (validateattributes, interp, args, nargout,
+               "-*- texinfo -*-\n\
+@deftypefn  {} {} validateattributes (@var{A}, @var{classes}, @var{attributes})\n\
+@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{arg_idx})\n\
+@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{func_name})\n\
+@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{func_name}, @var{arg_name})\n\
+@deftypefnx {} {} validateattributes (@var{A}, @var{classes}, @var{attributes}, @var{func_name}, @var{arg_name}, @var{arg_idx})\n\
+@deftypefnx {} {@var{info} =} validateattributes (@dots{})\n\
+@deftypefnx {} {[@var{info}, @var{summary}] =} validateattributes (@dots{})\n\
+@deftypefnx {} {@var{token} =} validateattributes (@dots{}, @{@dots{}, \"async\"@}, @dots{})\n\
+@deftypefnx {} {@var{violations} =} validateattributes (@dots{}, @{@dots{}, \"collect\"@}, @dots{})\n\
+@deftypefnx {} {@var{plan} =} validateattributes (@dots{}, @{@dots{}, \"explain\"@}, @dots{})\n\
+@deftypefnx {} {@var{where} =} validateattributes (@dots{}, @{@dots{}, \"locate\", @var{how}@}, @dots{})\n\
+@deftypefnx {} {@var{val} =} validateattributes (@var{option})\n\
+@deftypefnx {} {@var{old_val} =} validateattributes (@var{option}, @var{new_val})\n\
+@deftypefnx {} {} validateattributes (@var{option}, @var{new_val}, \"local\")\n\
+Check validity of input argument.\n\
+\n\
+Confirms that the argument @var{A} is valid by belonging to one of\n\
+@var{classes}, and holding all of the @var{attributes}.  If it does not,\n\
+an error is thrown, with a message formatted accordingly.  The error\n\
+message can be made further complete by the function name @var{fun_name},\n\
+the argument name @var{arg_name}, and its position in the input\n\
+@var{arg_idx}.\n\
+\n\
+@var{classes} must be a cell array of strings (an empty cell array is\n\
+allowed) with the name of classes (remember that a class name is case\n\
+sensitive).  In addition to the class name, the following categories\n\
+names are also valid:\n\
+\n\
+@table @asis\n\
+@item @qcode{\"float\"}\n\
+Floating point value comprising classes @qcode{\"double\"} and\n\
+@qcode{\"single\"}.\n\
+\n\
+@item @qcode{\"integer\"}\n\
+Integer value comprising classes (u)int8, (u)int16, (u)int32, (u)int64.\n\
+\n\
+@item @qcode{\"numeric\"}\n\
+Numeric value comprising either a floating point or integer value.\n\
+\n\
+@end table\n\
+\n\
+@var{attributes} must be a cell array with names of checks for @var{A}.\n\
+Some of them require an additional value to be supplied right after the\n\
+name (see details for each below).\n\
+\n\
+@table @asis\n\
+@item @qcode{\"<=\"}\n\
+All values are less than or equal to the following value in\n\
+@var{attributes}.\n\
+\n\
+@item @qcode{\"<\"}\n\
+All values are less than the following value in @var{attributes}.\n\
+\n\
+@item @qcode{\">=\"}\n\
+All values are greater than or equal to the following value in\n\
+@var{attributes}.\n\
+\n\
+@item @qcode{\">\"}\n\
+All values are greater than the following value in @var{attributes}.\n\
+\n\
+For these four comparisons, the value can also be an array that is\n\
+broadcast against @var{A}, such as a row vector with one bound for each\n\
+column of @var{A}.  The error message then tells the row, column, or\n\
+element of the bound that was violated.\n\
+\n\
+@item @qcode{\"2d\"}\n\
+A 2-dimensional matrix.  Note that vectors and empty matrices have\n\
+2 dimensions, one of them being of length 1, or both length 0.\n\
+\n\
+@item @qcode{\"3d\"}\n\
+Has no more than 3 dimensions.  A 2-dimensional matrix is a 3-D matrix\n\
+whose 3rd dimension is of length 1.\n\
+\n\
+@item @qcode{\"async\"}\n\
+Not a check but an option: return a token at once, and check the values of\n\
+@var{A} in the background.  @code{validateattributes_wait (@var{token})}\n\
+then waits for the checks and raises the error that would otherwise have\n\
+been raised, if any.  @var{A} can be modified meanwhile, the checks see its\n\
+value at the time of the call.\n\
+\n\
+@item @qcode{\"binary\"}\n\
+All values are either 1 or 0.\n\
+\n\
+@item @qcode{\"castable\"}\n\
+All values convert to the class named by the next value in\n\
+@var{attributes}, a numeric class or @qcode{\"logical\"}, without\n\
+saturating, rounding, or turning @var{NaN} into zero.  For a complex\n\
+value both parts must convert, and the imaginary part must be zero unless\n\
+the class is @qcode{\"double\"} or @qcode{\"single\"}.  The values are\n\
+checked where they are, so that a cast which follows copies them without\n\
+a further check.\n\
+\n\
+@item @qcode{\"collect\"}\n\
+Not a check but an option: do not stop at the first violation, and return\n\
+all of them instead of raising an error, with the class check first.\n\
+@var{violations} is a struct array with the fields @code{attribute},\n\
+@code{identifier} and @code{message} of each error that would have been\n\
+raised, and @code{index}, the linear index of the first element in\n\
+violation if it is known.  The value attributes are checked in a single\n\
+pass over @var{A}.  Without an output, all the messages are raised as one\n\
+error.\n\
+\n\
+@item @qcode{\"column\"}\n\
+Values are arranged in a single column.\n\
+\n\
+@item @qcode{\"decreasing\"}\n\
+No value is @var{NaN}, and each is less than the preceding one.\n\
+\n\
+@item @qcode{\"diag\"}\n\
+Value is a diagonal matrix.\n\
+\n\
+@item @qcode{\"even\"}\n\
+All values are even numbers.\n\
+\n\
+@item @qcode{\"explain\"}\n\
+Not a check but an option: return the plan of the checks without making\n\
+them.  @var{plan} is a struct array with the fields @code{attribute},\n\
+@code{stage} and @code{method} of each check, in the order they would be\n\
+made.  The method is @qcode{\"direct\"} for the classes and the stage\n\
+@qcode{\"shape\"}, and for the others one of @qcode{\"fused\"},\n\
+@qcode{\"kernel\"}, @qcode{\"sampled\"}, @qcode{\"implicit\"} for\n\
+diagonal and permutation matrices, @qcode{\"pattern\"} for attributes\n\
+answered from the index arrays of a sparse matrix, @qcode{\"generic\"}, or\n\
+@qcode{\"skipped\"} when the @qcode{\"level\"} option leaves them out.\n\
+\n\
+@item @qcode{\"finite\"}\n\
+All values are finite.\n\
+\n\
+@item @qcode{\"increasing\"}\n\
+No value is @var{NaN}, and each is greater than the preceding one.\n\
+\n\
+@item @qcode{\"integer\"}\n\
+All values are integer.  This is different than using @code{isinteger}\n\
+which only checks its an integer type.  This checks that each value in\n\
+@var{A} is an integer value, i.e., it has no decimal part.\n\
+\n\
+@item @qcode{\"locate\"}\n\
+Not a check but an option: return which elements of @var{A} break the\n\
+attributes that look at each element on its own, instead of raising an\n\
+error for them.  With the next value in @var{attributes} @qcode{\"mask\"},\n\
+@var{where} is a logical array of the size of @var{A}, true at those\n\
+elements.  With @qcode{\"indices\"}, it is a column of their linear\n\
+indices in increasing order, which is smaller when they are few.  They are\n\
+found in the same pass over @var{A} as the checks themselves, and always\n\
+in all of @var{A}, even with @qcode{\"sample\"}.  A sparse, diagonal, or\n\
+permutation matrix is not made full for this, so with\n\
+@qcode{\"indices\"} only the elements found take memory.  The other attributes,\n\
+and those the element-wise kernels do not handle for @var{A}, raise their\n\
+errors as usual, as do all of them when there is no output.\n\
+\n\
+@item @qcode{\"maxcolnnz\"}\n\
+No column has more nonzero elements than the next value in\n\
+@var{attributes}, or, for a sparse matrix, more stored elements.\n\
+\n\
+@item @qcode{\"maxnnz\"}\n\
+Has at most as many nonzero elements as the next value in\n\
+@var{attributes}, as counted by @code{nnz}.\n\
+\n\
+@item @qcode{\"ncols\"}\n\
+Has exactly as many columns as the next value in @var{attributes}.\n\
+\n\
+@item @qcode{\"ndims\"}\n\
+Has exactly as many dimensions as the next value in @var{attributes}.\n\
+\n\
+@item @qcode{\"nondecreasing\"}\n\
+No value is @var{NaN}, and each is greater than or equal to the preceding\n\
+one.\n\
+\n\
+@item @qcode{\"nonempty\"}\n\
+It is not empty.\n\
+\n\
+@item @qcode{\"nonincreasing\"}\n\
+No value is @var{NaN}, and each is less than or equal to the preceding one.\n\
+\n\
+@item @qcode{\"nonnan\"}\n\
+No value is a @code{NaN}.\n\
+\n\
+@item @nospell{@qcode{\"nonnegative\"}}\n\
+All values are non negative.\n\
+\n\
+@item @qcode{\"nonsparse\"}\n\
+It is not a sparse matrix.\n\
+\n\
+@item @qcode{\"nonzero\"}\n\
+No value is zero.\n\
+\n\
+@item @qcode{\"nostoredzeros\"}\n\
+No zero is stored explicitly in a sparse matrix.  Always true for other\n\
+values.\n\
+\n\
+@item @qcode{\"nrows\"}\n\
+Has exactly as many rows as the next value in @var{attributes}.\n\
+\n\
+@item @qcode{\"numel\"}\n\
+Has exactly as many elements as the next value in @var{attributes}.\n\
+\n\
+@item @qcode{\"odd\"}\n\
+All values are odd numbers.\n\
+\n\
+@item @qcode{\"positive\"}\n\
+All values are positive.\n\
+\n\
+@item @qcode{\"real\"}\n\
+It is a non-complex matrix.\n\
+\n\
+@item @qcode{\"realvalued\"}\n\
+No value has a nonzero imaginary part.  Unlike @qcode{\"real\"}, this\n\
+accepts a complex matrix whose imaginary parts are all zero.\n\
+\n\
+@item @qcode{\"row\"}\n\
+Values are arranged in a single row.\n\
+\n\
+@item @qcode{\"sample\"}\n\
+Not a check but an option: the attributes on the values of @var{A} only\n\
+look at the first and last element, and at one element drawn at random\n\
+from each of as many equal parts of the rest as the next value in\n\
+@var{attributes}.  The monotonic attributes compare each of those elements\n\
+with the preceding one.  All other attributes, and the values of sparse,\n\
+complex, and diagonal or permutation matrices, are always checked in full.\n\
+\n\
+@item @qcode{\"scalar\"}\n\
+It is a scalar.\n\
+\n\
+@item @qcode{\"size\"}\n\
+Its size has length equal to the values of the next in @var{attributes}.\n\
+The next value must is an array with the length for each dimension.  To\n\
+ignore the check for a certain dimension, the value of @code{NaN} can be\n\
+used.\n\
+\n\
+The next value can also be a cell array with one element for each\n\
+dimension: a length, @code{NaN} for any length, a range\n\
+@code{[@var{min} @var{max}]} of lengths, or @qcode{\"=@var{k}\"} for the\n\
+same length as dimension @var{k}.  The last element can be @qcode{\"...\"}\n\
+for any number of further dimensions of any length.  Dimensions past those\n\
+of @var{A} have length 1.  For example, @code{@{NaN, \"=1\", \"...\"@}}\n\
+requires square pages.\n\
+\n\
+@item @qcode{\"sortedindices\"}\n\
+The row indices stored in each column of a sparse matrix are strictly\n\
+increasing.  Always true for other values.\n\
+\n\
+@item @qcode{\"square\"}\n\
+Is a square matrix.\n\
+\n\
+@item @qcode{\"vector\"}\n\
+Values are arranged in a single vector (column or vector).\n\
+\n\
+@end table\n\
+\n\
+If requested, @var{info} is a struct with the fields:\n\
+\n\
+@table @code\n\
+@item sampled\n\
+True if any attribute was checked on a sample of @var{A} only.\n\
+\n\
+@item cached\n\
+True if the attributes were not checked because @var{A} already passed the\n\
+same ones, see the @qcode{\"cache\"} option.\n\
+\n\
+@end table\n\
+\n\
+If a second output is requested, after @var{info} or the @var{violations} of\n\
+@qcode{\"collect\"}, @var{summary} is a struct that describes the values of\n\
+@var{A}, gathered in the same pass as the element-wise checks, with the\n\
+fields:\n\
+\n\
+@table @code\n\
+@item min\n\
+@itemx max\n\
+The smallest and largest values other than NaN, as @code{min} and\n\
+@code{max} return them, or empty if there are none.\n\
+\n\
+@item nnan\n\
+@itemx ninf\n\
+@itemx nzero\n\
+The number of NaN, infinite, and zero values.\n\
+\n\
+@item nondecreasing\n\
+@itemx nonincreasing\n\
+Whether @var{A} passes the attribute of the same name.\n\
+\n\
+@end table\n\
+\n\
+The summary always covers all of @var{A}, even with @qcode{\"sample\"}.  Its\n\
+fields are empty for sparse, diagonal, and permutation matrices, for\n\
+values that are not arrays of numbers, characters, or logicals, and at the\n\
+level @qcode{\"off\"}, and the minimum, maximum, and order are empty for\n\
+complex values.\n\
+\n\
+The checks are made in stages of increasing cost, and an error is raised\n\
+for the first violation found in this order.  First the classes, then the\n\
+attributes that only look at the dimensions of @var{A}, then those that\n\
+look at each element on its own, which are checked together in a single\n\
+pass over @var{A} when possible, and last the monotonic attributes and\n\
+@qcode{\"diag\"}.  Within a stage, attributes are checked in the order they\n\
+are given.  Unknown attributes and missing values are reported before any\n\
+check is made.\n\
+\n\
+Called with the name of an @var{option}, query or set a process-wide\n\
+setting.  The previous value is returned.  When called from inside a\n\
+function with the @qcode{\"local\"} option, the setting is restored on exit\n\
+from the function.  The options are:\n\
+\n\
+@table @asis\n\
+@item @qcode{\"cache\"}\n\
+With @qcode{\"on\"}, remember the last few large arrays that passed all\n\
+@var{attributes}, and skip the checks when the same, unmodified array is\n\
+validated again against the same @var{attributes}.  The class check is\n\
+always done.  Up to 16 arrays are remembered, and each is kept in memory\n\
+for as long as it is also referenced elsewhere.  Since the cache shares\n\
+them, the first assignment to an element of one, as in\n\
+@code{@var{A}(@var{i}) = @var{x}}, copies all of it.\n\
+@qcode{\"off\"}, the default, forgets them at once.\n\
+\n\
+@item @qcode{\"level\"}\n\
+With @qcode{\"full\"}, the default, everything is checked.  With\n\
+@qcode{\"structural\"}, only the classes and the attributes that do not\n\
+look at the values of @var{A} are checked.  With @qcode{\"off\"},\n\
+@code{validateattributes} returns at once without looking at its\n\
+arguments.\n\
+\n\
+@item @qcode{\"sampling\"}\n\
+With @qcode{\"off\"}, all attributes are checked in full, even when\n\
+@qcode{\"sample\"} is given.  @qcode{\"on\"} is the default.\n\
+\n\
+@end table\n\
+\n\
+Diagonal and permutation matrices are checked from their stored diagonal\n\
+or permutation, without conversion to full matrices, except against a\n\
+comparison operand that is not a scalar.  The attributes\n\
+@qcode{\"maxnnz\"}, @qcode{\"maxcolnnz\"}, @qcode{\"nostoredzeros\"}, and\n\
+@qcode{\"sortedindices\"} read the index arrays of a sparse matrix in place,\n\
+the first in constant time, and are made at the @qcode{\"structural\"}\n\
+level.\n\
+\n\
+While the profiler is on, the class check, each attribute check, and the\n\
+construction of the error message are reported as children of\n\
+@code{validateattributes} named @qcode{\"validateattributes>classes\"},\n\
+@qcode{\"validateattributes>@var{attribute}\"}, and\n\
+@qcode{\"validateattributes>error\"} respectively.  The attributes checked\n\
+together in a single pass over @var{A} are reported as one child,\n\
+@qcode{\"validateattributes>fused\"}.\n\
+\n\
+@seealso{isa, validatestring, inputParser, profile, validateattributes_stats,\n\
+validateattributes_wait}\n\
+@end deftypefn ")
+{
+
+  octave_value       ov_A;
+  octave_value       ov_cls;
+  octave_value       ov_attr;
+
+  std::string        A_class;
+  Array<std::string> cls;
+  Cell               attr;
+
+  std::string        err_ini;
+  std::string        func_name;
+
+  std::string        var_name = "input";
+  octave_idx_type    nargin   = args.length ();
+
+  // options first, even at level "off", so that a "local" setting can turn
+  // the checks back on
+  if (nargin >= 1 && args(0).is_string ()
+      && (nargin < 2 || args(1).is_string ())
+      && find_option (args(0).string_value ()))
+    return set_option (interp, args, nargout);
+
+  if (validation_level == level_off && nargin >= 3)
+    {
+      if (nargout > 0 && has_option (args(2), attr_async))
+        return octave_value_list (octave_value (async_done_token));
+      else if (nargout > 0 && has_option (args(2), attr_explain))
+        return octave_value_list (make_plan (args(0), Array<std::string> (),
+                                             attr_spec ()));
+
+      octave_value_list retval;
+      octave_value      mode;
+      if (nargout > 0 && has_option (args(2), attr_collect))
+        retval(0) = make_violations (violation_log {interp});
+      else if (nargout > 0 && has_option (args(2), attr_locate, &mode))
+        {
+          location_set none (locate_lookup (mode), args(0).dims ());
+          retval(0) = make_locations (none);
+        }
+      else if (nargout > 0)
+        retval(0) = make_info (check_result ());
+      if (nargout > 1)
+        retval(1) = make_summary ();
+      return retval;
+    }
+
+  if (nargin < 3 || nargin > 6)
+    print_usage ();
+
+  ov_A    = args(0);
+  ov_cls  = args(1);
+  ov_attr = args(2);
+
+  if (! ov_cls.iscellstr ())
+    {
+      error_with_id (
+          "Octave:invalid-type",
+          "validateattributes: CLASSES must be a cell array of strings");
+    }
+  else if (! ov_attr.iscell ())
+    {
+      error_with_id ("Octave:invalid-type",
+                   "validateattributes: ATTRIBUTES must be a cell array");
+    }
+
+  cls  = ov_cls.cellstr_value ();
+  attr = ov_attr.cell_value ();
+
+  if (nargin > 3)
+    {
+      if (args(3).is_string ())
+        {
+          func_name = args(3).string_value () + ": ";
+        }
+      else if (nargin == 4 && is_valid_idx (args(3)))
+        {
+          var_name = "input " + std::to_string (args(3).idx_type_value ());
+        }
+      else
+        {
+          error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes: 4th input argument must be "
+                       "ARG_IDX or FUNC_NAME");
+        }
+
+      if (nargin > 4)
+        {
+          if (! args(4).is_string ())
+            {
+              error_with_id ("Octave:invalid-type",
+                           "validateattributes: VAR_NAME must be a string");
+            }
+          var_name = args(4).string_value ();
+
+          if (nargin > 5)
+            {
+              if (! is_valid_idx (args(5)))
+                {
+                  error_with_id ("Octave:invalid-input-arg",
+                               "validateattributes: ARG_IDX must be a "
+                               "positive integer");
+                }
+              var_name += " (argument #"
+                          + std::to_string (args(5).idx_type_value ()) + ")";
+            }
+        }
+    }
+
+  err_ini = func_name + var_name;
+
+  attr_spec spec = parse_attributes (attr);
+
+  if (spec.explain)
+    return octave_value_list (make_plan (ov_A, cls, spec));
+
+  if (spec.async)
+    return octave_value_list (octave_value (start_async (ov_A, cls, spec,
+                                                         err_ini)));
+
+  octave::profiler& prof = interp.get_profiler ();
+  violation_log     log {interp};
+
+  if (! cls.isempty ())
+    {
+      bool ok;
+      stats_probe probe (stats_class_row, ov_A.builtin_type (), 0);
+
+      {
+        profile_block block (prof, profile_phase ("classes"));
+        ok = chk_class (ov_A, cls);
+      }
+
+      if (! ok)
+        {
+          probe.fail ();
+          profile_block block (prof, profile_phase ("error"));
+          if (spec.collect)
+            log.record ("(classes)", -1, [&] ()
+                        { cls_error (err_ini, cls, ov_A.class_name ()); });
+          else
+            cls_error (err_ini, cls, ov_A.class_name ());
+        }
+    }
+
+  // without an output, the violations "locate" finds are raised
+  location_set where;
+  bool         locate = (spec.locate != locate_none && nargout > 0);
+
+  check_result result = chk_attributes (ov_A, spec, err_ini, prof,
+                                        spec.collect ? &log : nullptr,
+                                        nargout > 1,
+                                        locate ? &where : nullptr);
+
+  octave_value_list retval;
+  if (nargout > 1)
+    retval(1) = (result.summary.is_defined () ? result.summary
+                                              : make_summary ());
+
+  if (spec.collect)
+    {
+      if (nargout > 0)
+        {
+          retval(0) = make_violations (log);
+          return retval;
+        }
+      else if (! log.list.empty ())
+        {
+          // nowhere to return them, so raise them all at once
+          std::string msg;
+          for (const violation& v : log.list)
+            msg += (msg.empty () ? "" : "\n") + v.message;
+          error_with_id (log.list[0].identifier.c_str (), "%s", msg.c_str ());
+        }
+    }
+  else if (locate)
+    {
+      retval(0) = make_locations (where);
+      return retval;
+    }
+  else if (nargout > 0)
+    {
+      retval(0) = make_info (result);
+      return retval;
+    }
+
+  return octave_value_list ();
+}
+
+/*
+%!error <double> validateattributes (rand (5), {"uint8"}, {})
+%!error <single> validateattributes (uint8 (rand (5)), {"float"}, {})
+%!error <2d> validateattributes (rand (5, 5, 5), {}, {"2d"})
+%!error <3d> validateattributes (rand (5, 5, 5, 7), {}, {"3d"})
+%!error <column> validateattributes (rand (5, 5), {}, {"column"})
+%!error <column> validateattributes (rand (1, 5), {}, {"column"})
+%!error <row> validateattributes (rand (5, 5), {}, {"row"})
+%!error <row> validateattributes (rand (5, 1), {}, {"row"})
+%!error <scalar> validateattributes (rand (1, 5), {}, {"scalar"})
+%!error <vector> validateattributes (rand (5), {}, {"vector"})
+%!error <square> validateattributes (rand (5, 6), {}, {"square"})
+%!error <nonempty> validateattributes ([], {}, {"nonempty"})
+%!error <nonsparse> validateattributes (sparse(rand(5)), {}, {"nonsparse"})
+%!error <binary> validateattributes ("text", {}, {"binary"})
+%!error <binary> validateattributes ([0 1 0 3 0], {}, {"binary"})
+%!error <even> validateattributes ([2 3 6 8], {}, {"even"})
+%!error <even> validateattributes ([2 NaN], {}, {"even"})
+%!error <odd> validateattributes ([3 4 7 5], {}, {"odd"})
+%!error <odd> validateattributes ([5 NaN], {}, {"odd"})
+%!error <integer> validateattributes ([5 5.2 5.7], {}, {"integer"})
+%!error <real> validateattributes ([5i 8 9], {}, {"real"})
+%!error <finite> validateattributes ([5i Inf 8], {}, {"finite"})
+%!error <nonnan> validateattributes ([NaN Inf 8], {}, {"nonnan"})
+%!error <nonnegative> validateattributes ([7 8 -9], {}, {"nonnegative"})
+%!error <nonzero> validateattributes ([7 8 0], {}, {"nonzero"})
+%!error <positive> validateattributes ([7 0 8], {}, {"positive"})
+%!error <decreasing> validateattributes ([7 8 4 3 -5], {}, {"decreasing"})
+%!error <decreasing> validateattributes ([7 NaN 4 3 -5], {}, {"decreasing"})
+%!error <increasing> validateattributes ([7 8 4 9 20], {}, {"increasing"})
+%!error <increasing> validateattributes ([7 8 NaN 9 20], {}, {"increasing"})
+%!error <nonincreasing> validateattributes ([7 8 4 9 20], {}, {"nonincreasing"})
+%!error <nonincreasing> validateattributes ([7 8 NaN 9 20], {}, {"nonincreasing"})
+%!error <nondecreasing> validateattributes ([7 8 4 3 -5], {}, {"nondecreasing"})
+%!error <nondecreasing> validateattributes ([7 NaN 4 3 -5], {}, {"nondecreasing"})
+%!error <size> validateattributes (ones (5, 3, 6), {}, {"size", [5 4 7]})
+%!error <size> validateattributes (ones (5, 3, 6), {}, {"size", [5 NaN 7]})
+%!error <size> validateattributes (ones (5, 3, 6), {}, {"size", [5 3 6 2]})
+%!error <elements> validateattributes (ones (6, 3), {}, {"numel", 12})
+%!error <columns> validateattributes (ones (6, 2), {}, {"ncols", 3})
+%!error <rows> validateattributes (ones (6, 2), {}, {"nrows", 3})
+%!error <dimensions> validateattributes (ones (6, 2, 6, 3), {}, {"ndims", 3})
+%!error <input must have 12 elements$> validateattributes (ones (6, 3), {}, {"numel", 12})
+%!error <input must have 3 columns$> validateattributes (ones (6, 2), {}, {"ncols", 3})
+%!error <input must have 3 rows$> validateattributes (ones (6, 2), {}, {"nrows", 3})
+%!error <input must have 3 dimensions$> validateattributes (ones (6, 2, 6, 3), {}, {"ndims", 3})
+%!error <greater than> validateattributes ([6 7 8 5], {}, {">", 5})
+%!error <greater than 1[0-9]{99}\.000000 \(first violation> validateattributes (1, {}, {">", 1e100})
+%!error <greater than> validateattributes ([6 7 8 5], {}, {">=", 6})
+%!error <less than> validateattributes ([6 7 8 5], {}, {"<", 8})
+%!error <less than> validateattributes ([6 7 8 5], {}, {"<=", 7})
+%!error <diag> validateattributes ([0 0 0; 0 0 0; 1 0 0], {}, {"diag"})
+%!error <diag> validateattributes (repmat (eye (3), [1 1 3]), {}, {"diag"})
+
+%!test validateattributes (rand (5), {"numeric"}, {});
+%!test validateattributes (rand (5), {"float"}, {});
+%!test validateattributes (rand (5), {"double"}, {});
+%!test validateattributes ("text", {"char"}, {});
+%!test validateattributes (rand (5), {}, {"2d"});
+%!test validateattributes (rand (5), {}, {"3d"});
+%!test validateattributes (rand (5, 5, 5), {}, {"3d"});
+%!test validateattributes (rand (5, 1), {}, {"column"});
+%!test validateattributes (rand (1, 5), {}, {"row"});
+%!test validateattributes ("a", {}, {"scalar"});
+%!test validateattributes (5, {}, {"scalar"});
+%!test validateattributes (rand (1, 5), {}, {"vector"});
+%!test validateattributes (rand (5, 1), {}, {"vector"});
+%!test validateattributes (rand (5), {}, {"square"});
+%!test validateattributes (rand (5), {}, {"nonempty"});
+%!test validateattributes (rand (5), {}, {"nonsparse"});
+%!test validateattributes ([0 1 0 1 0], {}, {"binary"});
+%!test validateattributes (rand (5) > 0.5, {}, {"binary"});
+%!test validateattributes ([8 4 0 6], {}, {"even"});
+%!test validateattributes ([-1 3 5], {}, {"odd"});
+%!test validateattributes ([8 4 0 6], {}, {"real"});
+%!test validateattributes ([8 4i 0 6], {}, {"finite"});
+%!test validateattributes (uint8 ([8 4]), {}, {"finite"});
+%!test validateattributes ([8 Inf], {}, {"nonnan"});
+%!test validateattributes ([0 7 4], {}, {"nonnegative"});
+%!test validateattributes ([-8 7 4], {}, {"nonzero"});
+%!test validateattributes ([8 7 4], {}, {"positive"});
+%!test validateattributes ([8 7 4 -5], {}, {"decreasing"});
+%!test validateattributes ([-8 -7 4 5], {}, {"increasing"});
+%!test validateattributes ([8 4 4 -5], {}, {"nonincreasing"});
+%!test validateattributes ([-8 -8 4 5], {}, {"nondecreasing"});
+%!test validateattributes (rand (4, 6, 7, 2), {}, {"size", [4 6 7 2]});
+%!test validateattributes (rand (4, 6, 7, 2), {}, {"size", [4 NaN 7 2]});
+%!test validateattributes (rand (4, 6, 7, 2), {}, {"size", [4 6 NaN 2 NaN]});
+%!test validateattributes (rand (6, 2), {}, {"numel", 12});
+%!test validateattributes (rand (6, 2), {}, {"ncols", 2});
+%!test validateattributes (rand (6, 2), {}, {"nrows", 6});
+%!test validateattributes (rand (6, 2, 4, 5), {}, {"ndims", 4});
+%!test validateattributes ([4 5 6 7], {}, {">", 3});
+%!test validateattributes ([4 5 6 7], {}, {">=", 4});
+%!test validateattributes ([4 5 6 7], {}, {"<", 8});
+%!test validateattributes ([4 5 6 7], {}, {"<=", 7});
+%!test validateattributes (eye (3), {}, {"diag"});
+%!test validateattributes ([1 0 0; 0 1 0; 0 0 1], {}, {"diag"});
+%!test validateattributes (zeros (3), {}, {"diag"});
+%!test validateattributes ([0 1 0 1], {"double", "uint8"}, {"binary", "size", [NaN 4], "nonnan"});
+%!test validateattributes (uint8 ([5 3 1]), {}, {"decreasing"});
+%!test validateattributes (single ([1 2 3]), {}, {"increasing", "positive", "integer"});
+%!test validateattributes (int64 (2^53) + 1, {}, {">", 2^53});
+%!test validateattributes ("abc", {}, {"increasing", ">=", 97});
+%!error <greater than> validateattributes (int64 ([1 2]), {}, {">", 1.5})
+%!error <greater than> validateattributes (int64 (2^53) + 1, {}, {">", int64 (2^53) + 1})
+%!test validateattributes (uint64 (2^64) - 1, {}, {">", uint64 (2^64) - 2});
+%!test
+%! b = int64 ([2^53 -2^53]) + int64 ([1 -1]);
+%! validateattributes (b, {}, {"<=", b, ">=", b});
+%!error <nonnan> validateattributes (single ([1 NaN]), {}, {"nonnan"})
+%!error <odd> validateattributes (int8 ([-3 -1 2]), {}, {"odd"})
+%!test validateattributes (ones (4, 4, 3), {}, {"size", {NaN, "=1", "..."}});
+%!test validateattributes (ones (4, 4), {}, {"size", {NaN, "=1", "..."}});
+%!test validateattributes (ones (3, 7), {}, {"size", {[2 4], [5 Inf]}});
+%!test validateattributes (ones (3, 7), {}, {"size", {3, NaN, 1}});
+%!test validateattributes (ones (3, 7, 2, 2), {}, {"size", {3, "..."}});
+%!error <must be of size Nx=1x... but was 4x5x3$> validateattributes (ones (4, 5, 3), {}, {"size", {NaN, "=1", "..."}})
+%!error <must be of size 2:4x5:Inf but was 3x4$> validateattributes (ones (3, 4), {}, {"size", {[2 4], [5 Inf]}})
+%!error <must be of size 3 but was 3x7$> validateattributes (ones (3, 7), {}, {"size", {3}})
+%!error <invalid element 2 of SIZE> validateattributes (1, {}, {"size", {1, "...", 1}})
+%!error <invalid element 1 of SIZE> validateattributes (1, {}, {"size", {"=1"}})
+%!test validateattributes ([1 2 3; 4 5 6], {}, {">", [0 1 2], "<=", [3; 6]});
+%!test validateattributes (int8 ([1 2 3; 4 5 6]), {}, {">=", [1 2 3; 4 5 6]});
+%!test validateattributes (ones (2, 2, 3), {}, {"<", cat (3, 2, 3, 4)});
+%!error <greater than 2.000000 in column 3 \(first violation: element 5, subscript \(1,3\), value 2\)> validateattributes ([1 2 2; 4 5 6], {}, {">", [0 1 2]})
+%!error <less than or equal to 3.000000 in row 1> validateattributes ([1 2 4; 4 5 6], {}, {"<=", [3; 6]})
+%!error <less than 3.000000 at element 2 of the bound> validateattributes (ones (2, 2, 3) * 3, {}, {"<", cat(3, 4, 3, 4)})
+%!error <nonconformant> validateattributes ([1 2 3], {}, {">", [0 1]})
+%!test validateattributes ([1+2i 3i -4], {}, {"nonnan", "finite", "nonzero", "positive", "nonnegative"});
+%!test validateattributes (single ([1+2i 3i -4]), {}, {">", 0.5, "<=", 4.5});
+%!test validateattributes (complex ([1 2], [0 0]), {}, {"realvalued"});
+%!test validateattributes ([1 2], {}, {"realvalued"});
+%!test validateattributes ([-1 1i], {}, {"<", 1.5, ">=", 1});
+%!error <less than or equal to> validateattributes ([1i -4], {}, {"<=", 4})
+%!test validateattributes (complex ([1 0; 0 2]), {}, {"diag"});
+%!error <nonnan \(first violation: element 2, value 1\+NaNi\)> validateattributes ([1i complex(1, NaN)], {}, {"nonnan"})
+%!error <finite> validateattributes ([1i complex(Inf, 1)], {}, {"finite"})
+%!error <nonzero> validateattributes (complex ([1 0]), {}, {"nonzero"})
+%!error <positive> validateattributes (complex ([1 0]), {}, {"positive"})
+%!error <greater than> validateattributes ([2i -1], {}, {">", 1})
+%!error <less than> validateattributes (single ([1i -2]), {}, {"<", 2})
+%!error <realvalued \(first violation: element 2, value 2\+1i\)> validateattributes ([1 2+1i], {}, {"realvalued"})
+%!error <real> validateattributes (complex ([1 2], [0 0]), {}, {"real"})
+%!error <must be of size 5x4x7 but was 5x3x6$> validateattributes (ones (5, 3, 6), {}, {"size", [5 4 7]})
+%!error <must be of size 5xNx7 but was 5x3x6$> validateattributes (ones (5, 3, 6), {}, {"size", [5 NaN 7]})
+%!error <nonnegative \(first violation: element 3, value -9\)$> validateattributes ([7 8 -9], {}, {"nonnegative"})
+%!error <element 6, subscript \(3,2\), value 0\)$> validateattributes ([1 2 3; 4 5 0]', {}, {"positive"})
+%!error <greater than 5.000000 \(first violation: element 4, value 5\)$> validateattributes ([6 7 8 5], {}, {">", 5})
+%!error <increasing \(first violation: element 3, value NaN\)$> validateattributes ([7 8 NaN 9 20], {}, {"increasing"})
+
+## single values against double operands, as double would compare them
+%!test validateattributes (single ([0.1 1]), {}, {">", 0.1, "<", 1 + eps, ">=", 0.1});
+%!test validateattributes (single ([1e38 -Inf]), {}, {"<", realmax, "<=", 1e39});
+%!test validateattributes (single (Inf), {}, {">", realmax});
+%!test validateattributes (single (2^-149), {}, {">", 2^-150, ">=", 2^-149});
+%!error <less than or equal to> validateattributes (single (0.1), {}, {"<=", 0.1})
+%!test validateattributes (single (16777216), {}, {"<", 16777217});
+%!error <less than or equal to> validateattributes (single (16777218), {}, {"<=", 16777217.5})
+%!error <less than> validateattributes (single ([Inf 1]), {}, {"<", Inf})
+%!error <greater than or equal to> validateattributes (single (2^-149), {}, {">=", 2^-148})
+%!error <less than> validateattributes (single ([1 2; 3 4]), {}, {"<", [2.5; 3.5]})
+
+## castable
+%!test
+%! validateattributes ([1 -2 3], {}, {"castable", "int8"});
+%! validateattributes ([0 255], {}, {"castable", "uint8"});
+%! validateattributes ([0.5 NaN -Inf], {}, {"castable", "single"});
+%! validateattributes (int64 ([1 2^53]), {}, {"castable", "double"});
+%! validateattributes (single ([1.5 2]), {}, {"castable", "double"});
+%! validateattributes ([true false], {}, {"castable", "int8"});
+%! validateattributes ([0 1 0], {}, {"castable", "logical"});
+%! validateattributes (complex ([1 2], 0), {}, {"castable", "int32"});
+%! validateattributes (sparse ([0 3; 0 0]), {}, {"castable", "uint8"});
+%! validateattributes (eye (3), {}, {"castable", "logical"});
+%! validateattributes ("abc", {}, {"castable", "int8"});
+%! validateattributes ([1 2 3], {}, {"positive", "castable", "uint8", "integer"});
+%!error <must convert to int32 without loss \(first violation: element 2, value 1.5\)$> validateattributes ([1 1.5], {}, {"castable", "int32"})
+%!error <element 3, value 256\)$> validateattributes ([0 255 256], {}, {"castable", "uint8"})
+%!error <element 1, value NaN\)$> validateattributes ([NaN 1], {}, {"castable", "int16"})
+%!error <element 2, value -1\)$> validateattributes (int64 ([1 -1]), {}, {"castable", "uint16"})
+%!error <convert to double without loss> validateattributes (intmax ("int64"), {}, {"castable", "double"})
+%!error <convert to single without loss> validateattributes (0.1, {}, {"castable", "single"})
+%!error <element 2, value 1\+2i\)$> validateattributes ([1 1+2i], {}, {"castable", "int8"})
+%!error <element 4, subscript \(2,2\)\)$> validateattributes (sparse ([1 0; 0 0.5]), {}, {"castable", "int8"})
+%!error <element 5, subscript \(2,2\)\)$> validateattributes (diag ([1 0.5 1]), {}, {"castable", "int8"})
+%!error <convert to int8 without loss> validateattributes ({1}, {}, {"castable", "int8"})
+%!error <must name a numeric class or "logical"> validateattributes (1, {}, {"castable", "char"})
+%!error <must name a numeric class or "logical"> validateattributes (1, {}, {"castable", 8})
+
+## sparse pattern
+%!test
+%! S = sparse ([1 0 2; 0 0 3; 4 0 0]);
+%! validateattributes (S, {}, {"maxnnz", 4, "maxcolnnz", 2, "nostoredzeros",
+%!                             "sortedindices"});
+%! validateattributes (full (S), {}, {"MaxNNZ", 4, "maxcolnnz", 2,
+%!                                    "nostoredzeros", "sortedindices"});
+%! validateattributes (sparse (5, 5), {}, {"maxnnz", 0, "maxcolnnz", 0});
+%! validateattributes (eye (3), {}, {"maxcolnnz", 1});
+%! validateattributes (logical (sparse ([1 0; 1 1])), {}, {"maxcolnnz", 2});
+%!error <at most 3 nonzero elements$> validateattributes (sparse ([1 0 2; 0 0 3; 4 0 0]), {}, {"maxnnz", 3})
+%!error <at most 1 nonzero elements in each column \(first violation: element 3, subscript \(3,1\)\)$> validateattributes (sparse ([1 0 2; 0 0 3; 4 0 0]), {}, {"maxcolnnz", 1})
+%!error <element 3, subscript \(3,1\), value 4\)$> validateattributes ([1 0 2; 0 0 3; 4 0 0], {}, {"maxcolnnz", 1})
+%!error <element 4, subscript \(2,2\)> validateattributes (sparse ([0 0; 0 5i]), {}, {"maxcolnnz", 0})
+%!test
+%! ## from the diagonal or the permutation, without making them full
+%! validateattributes (eye (1e5), {}, {"maxcolnnz", 1});
+%! validateattributes (eye (1e5)(:, [2:1e5, 1]), {}, {"maxcolnnz", 1});
+%! validateattributes (diag (zeros (1, 3)), {}, {"maxcolnnz", 0});
+%!error <element 5, subscript \(2,2\)> validateattributes (diag ([0 2 3]), {}, {"maxcolnnz", 0})
+%!error <element 2, subscript \(2,1\)> validateattributes (eye (3)(:, [2 3 1]), {}, {"maxcolnnz", 0})
+%!error <at most 1 nonzero> validateattributes ({1}, {}, {"maxnnz", 1})
+%!error <nonnegative integer> validateattributes (1, {}, {"maxnnz", -1})
+%!error <nonnegative integer> validateattributes (1, {}, {"maxcolnnz", 1.5})
+%!test
+%! p = validateattributes (sparse (1), {}, {"maxcolnnz", 1, "maxnnz", 1,
+%!                                          "explain"});
+%! assert ({p.attribute}, {"maxnnz", "maxcolnnz"});
+%! assert ({p.method}, {"direct", "pattern"});
+%! old = validateattributes ("level", "structural");
+%! unwind_protect
+%!   validateattributes (sparse ([-1 1]), {}, {"maxcolnnz", 1, "positive"});
+%!   fail ('validateattributes (sparse ([1; 1]), {}, {"maxcolnnz", 1})',
+%!         "at most 1");
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+
+## diagonal and permutation matrices
+%!test validateattributes (eye (1e5), {}, {"diag", "nonnegative", "finite", "integer", "binary", "<=", 1});
+%!test validateattributes (diag (single ([1 2 3])), {}, {"nonnan", ">=", 0, "<", 4});
+%!test validateattributes (eye (1), {}, {"positive", "nonzero", "increasing"});
+%!test validateattributes (eye (3)(:, [1 2 3]), {}, {"diag"});
+%!test validateattributes (eye (1e5)(:, [2:1e5 1]), {}, {"binary", "nonnegative", "<=", 1});
+%!error <positive \(first violation: element 2\)> validateattributes (eye (3), {}, {"positive"})
+%!error <nonnegative \(first violation: element 5\)> validateattributes (diag ([1 -2 3]), {}, {"nonnegative"})
+%!error <nondecreasing \(first violation: element 2\)> validateattributes (diag ([1 2]), {}, {"nondecreasing"})
+%!error <greater than 0.000000 \(first violation: element 2\)> validateattributes (eye (2, 3), {}, {">", 0})
+%!error <diag \(first violation: element 2\)> validateattributes (eye (3)(:, [2 1 3]), {}, {"diag"})
+%!error <nonzero \(first violation: element 1\)> validateattributes (eye (3)(:, [2 1 3]), {}, {"nonzero"})
+%!error <nonincreasing> validateattributes (eye (1e5)(:, [2:1e5 1]), {}, {"nonincreasing"})
+
+%!test
+%! info = validateattributes (ones (1, 1e4), {}, {"positive", "sample", 10});
+%! assert (info.sampled, true);
+%! info = validateattributes (ones (1, 5), {}, {"positive", "sample", 10});
+%! assert (info.sampled, false);
+%! info = validateattributes (ones (1, 1e4), {}, {"sample", 10, "size", [1 NaN]});
+%! assert (info.sampled, false);
+%!test
+%! x = ones (1, 1e4);
+%! x(2000:3200) = 0;
+%! fail ('validateattributes (x, {}, {"sample", 10, "positive"})', "positive");
+%! x = 1:1e4;
+%! x(2000:3200) = 1;
+%! fail ('validateattributes (x, {}, {"increasing", "sample", 10})', "increasing");
+%!test
+%! x = ones (1, 1e4);
+%! x(5000) = 0;
+%! old = validateattributes ("sampling", "off");
+%! unwind_protect
+%!   assert (validateattributes ("sampling"), "off");
+%!   fail ('validateattributes (x, {}, {"positive", "sample", 10})', "positive");
+%! unwind_protect_cleanup
+%!   validateattributes ("sampling", old);
+%! end_unwind_protect
+%!error <positive> validateattributes ([ones(1, 1e4) 0], {}, {"positive", "sample", 10})
+%!error <positive> validateattributes ([0 ones(1, 1e4)], {}, {"positive", "sample", 10})
+%!error <SAMPLE must be a positive integer> validateattributes (1, {}, {"sample", 0})
+%!error <Incorrect number> validateattributes (1, {}, {"sample"})
+%!error <Invalid call> validateattributes ("foo", "on")
+%!error <Invalid call> validateattributes ("abc")
+%!error <Invalid call> validateattributes ("abc", "x")
+%!error <invalid value "maybe" for sampling> validateattributes ("sampling", "maybe")
+
+%!test
+%! old = validateattributes ("level", "structural");
+%! unwind_protect
+%!   validateattributes ([1 -1 NaN], {"numeric"}, {"positive", "row", "increasing", ">", 2});
+%!   fail ('validateattributes ([1 -1], {}, {"positive", "column"})', "column");
+%!   fail ('validateattributes ([1 -1], {"char"}, {"positive"})', "char");
+%!   validateattributes ("level", "off");
+%!   assert (validateattributes ("level"), "off");
+%!   validateattributes ([1 -1], {"char"}, {"column", "positive", "bogus"});
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+%! assert (validateattributes ("level"), "full");
+
+%!function va_level_full_local (x)
+%!  validateattributes ("level", "full", "local");
+%!  validateattributes (x, {}, {"positive"});
+%!endfunction
+%!test
+%! old = validateattributes ("level", "off");
+%! unwind_protect
+%!   fail ("va_level_full_local (-1)", "must be positive");
+%!   assert (validateattributes ("level"), "off");
+%!   validateattributes (-1, {}, {"positive"});
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+
+%!test
+%! old = validateattributes ("cache", "on");
+%! unwind_protect
+%!   x = cumsum (ones (1, 2000));
+%!   info = validateattributes (x, {}, {"positive", "increasing"});
+%!   assert (info.cached, false);
+%!   info = validateattributes (x, {}, {"positive", "increasing"});
+%!   assert (info.cached, true);
+%!   info = validateattributes (x, {}, {"increasing", "positive"});
+%!   assert (info.cached, false);
+%!   info = validateattributes (x, {}, {"positive", ">", 0});
+%!   assert (info.cached, false);
+%!   info = validateattributes (x, {}, {"positive", ">", 0});
+%!   assert (info.cached, true);
+%!   y = x;
+%!   y(1000) = 0;
+%!   fail ('validateattributes (y, {}, {"positive", "increasing"})', "positive");
+%!   info = validateattributes (x, {}, {"positive", "increasing"});
+%!   assert (info.cached, true);
+%!   fail ('validateattributes (x, {"char"}, {"positive", "increasing"})', "char");
+%!   ## 64-bit operands are not rounded in the key
+%!   z = int64 (2^53) + int64 (1:2000);
+%!   validateattributes (z, {}, {">", int64 (2^53)});
+%!   fail ('validateattributes (z, {}, {">", int64 (2^53) + 1})', "greater than");
+%!   ## turning the cache off forgets the arrays at once
+%!   validateattributes ("cache", "off");
+%!   validateattributes ("cache", "on");
+%!   info = validateattributes (x, {}, {"positive", "increasing"});
+%!   assert (info.cached, false);
+%! unwind_protect_cleanup
+%!   validateattributes ("cache", old);
+%! end_unwind_protect
+
+%!test
+%! try validateattributes (ones(1,2,3), {"numeric"}, {"2d"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-2d");
+%! end_try_catch
+
+%!test
+%! try validateattributes (ones(1,2,3,4), {"numeric"}, {"3d"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-3d");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"column"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-column");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2].', {"numeric"}, {"row"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-row");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"scalar"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-scalar");
+%! end_try_catch
+
+%!test
+%! try validateattributes (ones(3), {"numeric"}, {"vector"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-vector");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"size", [1 1]});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:incorrect-size");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"numel", 7});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:incorrect-numel");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"ncols", 7});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:incorrect-numcols");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"nrows", 7});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:incorrect-numrows");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"ndims", 5});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:incorrect-numdims");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"square"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-square");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"diag"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-diag");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([], {"numeric"}, {"nonempty"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nonempty");
+%! end_try_catch
+
+%!test
+%! try validateattributes (speye(2), {"numeric"}, {"nonsparse"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nonsparse");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {">", 3});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-greater");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {">=", 3});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-greater-equal");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"<", -3});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-less");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"<=", -3});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-less-equal");
+%! end_try_catch
+
+%!test
+%! try validateattributes (3, {"numeric"}, {"binary"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-binary");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1, {"numeric"}, {"even"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-even");
+%! end_try_catch
+
+%!test
+%! try validateattributes (2, {"numeric"}, {"odd"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-odd");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1.1, {"numeric"}, {"integer"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-integer");
+%! end_try_catch
+
+%!test
+%! try validateattributes (1+1i*2, {"numeric"}, {"real"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-real");
+%! end_try_catch
+
+%!test
+%! try validateattributes (Inf, {"numeric"}, {"finite"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-finite");
+%! end_try_catch
+
+%!test
+%! try validateattributes (NaN, {"numeric"}, {"nonnan"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nonnan");
+%! end_try_catch
+
+%!test
+%! try validateattributes (-1, {"numeric"}, {"nonnegative"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nonnegative");
+%! end_try_catch
+
+%!test
+%! try validateattributes (0, {"numeric"}, {"nonzero"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nonzero");
+%! end_try_catch
+
+%!test
+%! try validateattributes (-1, {"numeric"}, {"positive"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-positive");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"decreasing"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-decreasing");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([2 1], {"numeric"}, {"increasing"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-increasing");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 0], {"numeric"}, {"nondecreasing"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nondecreasing");
+%! end_try_catch
+
+%!test
+%! try validateattributes ([1 2], {"numeric"}, {"nonincreasing"});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:expected-nonincreasing");
+%! end_try_catch
+
+%!test
+%! try validateattributes (@sin, {"numeric"}, {});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:invalid-type");
+%! end_try_catch
+
+%!test
+%! try validateattributes (@sin, 1, {});
+%! catch id,
+%! assert (getfield (id, "identifier"), "Octave:invalid-type");
+%! end_try_catch
+
+%!test
+%! profile off;
+%! profile clear;
+%! profile on;
+%! unwind_protect
+%!   validateattributes ([1 2 3], {"numeric"}, {"nonnan", "increasing"});
+%!   validateattributes ([1 2 3], {}, {"positive", "finite"});
+%!   try validateattributes (-1, {}, {"positive"}); end_try_catch
+%! unwind_protect_cleanup
+%!   profile off;
+%! end_unwind_protect
+%! names = {profile("info").FunctionTable.FunctionName};
+%! profile clear;
+%! assert (any (strcmp (names, "validateattributes>classes")));
+%! assert (any (strcmp (names, "validateattributes>nonnan")));
+%! assert (any (strcmp (names, "validateattributes>increasing")));
+%! assert (any (strcmp (names, "validateattributes>error")));
+%! assert (any (strcmp (names, "validateattributes>fused")));
+
+## "collect"
+%!test
+%! v = validateattributes ([1 2 3], {"numeric"}, {"positive", "collect"});
+%! assert (size (v), [1 0]);
+%! assert (isfield (v, {"attribute", "identifier", "message", "index"}));
+%!test
+%! x = [1:5000 -1 0.5 NaN];
+%! v = validateattributes (x, {"single"}, {"nonnegative", "collect", "finite",
+%!                                         "integer", "<", 10, "vector"});
+%! assert ({v.attribute}, {"(classes)", "nonnegative", "finite", "integer", "<"});
+%! assert ({v.identifier}, {"Octave:invalid-type", "Octave:expected-nonnegative",
+%!                          "Octave:expected-finite", "Octave:expected-integer",
+%!                          "Octave:expected-less"});
+%! assert ({v.index}, {[], 5001, 5003, 5002, 10});
+%! assert (v(2).message, "input must be nonnegative (first violation: element 5001, value -1)");
+%!test
+%! v = validateattributes (sparse ([1 -1]), {}, {"positive", "column", "collect"});
+%! assert ({v.attribute}, {"column", "positive"});
+%!error <must be positive
+input must be integer> validateattributes ([-1 0.5], {}, {"positive", "integer", "collect"})
+%!error <unknown attribute> validateattributes (1, {}, {"collect", "bogus"})
+%!error <cannot be combined> validateattributes (1, {}, {"collect", "async"})
+
+## order of the checks
+%!error <scalar> validateattributes ([NaN 2 1], {}, {"nonnan", "increasing", "scalar"})
+%!error <nonnan> validateattributes ([NaN 2 1], {}, {"increasing", "nonnan"})
+%!error <integer> validateattributes ([1 0.5 -1], {}, {"integer", "positive"})
+%!error <positive> validateattributes ([1 0.5 -1], {}, {"positive", "integer"})
+%!error <unknown attribute> validateattributes ([1 2], {}, {"scalar", "bogus"})
+%!test
+%! p = validateattributes (rand (10), {"double"}, {"increasing", "positive",
+%!                                                 "finite", "2d", "explain"});
+%! assert ({p.attribute}, {"(classes)", "2d", "positive", "finite", "increasing"});
+%! assert ({p.stage}, {"classes", "shape", "element", "element", "structural"});
+%! assert ({p.method}, {"direct", "direct", "fused", "fused", "kernel"});
+%!test
+%! p = validateattributes (-1, {}, {"positive", "explain"});
+%! assert (p.method, "kernel");
+%! p = validateattributes (eye (3), {}, {"nonnegative", "explain"});
+%! assert (p.method, "implicit");
+%! p = validateattributes (sparse (1), {}, {"nonnegative", "explain"});
+%! assert (p.method, "generic");
+%! p = validateattributes (ones (1, 100), {}, {"nonnegative", "sample", 10, "explain"});
+%! assert (p.method, "sampled");
+
+## locate
+%!test
+%! A = [1 NaN 3; -2 5.5 6];
+%! attr = {"nonnan", "positive", "integer", "<=", 5.5};
+%! assert (validateattributes (A, {}, [attr, {"locate", "mask"}]),
+%!         logical ([0 1 0; 1 1 1]));
+%! assert (validateattributes (A, {}, [attr, {"locate", "indices"}]),
+%!         [2; 3; 4; 6]);
+%! assert (validateattributes ([1 2], {}, {"finite", "locate", "indices"}),
+%!         zeros (0, 1));
+%! assert (validateattributes (single (A), {}, [attr, {"locate", "indices"}]),
+%!         [2; 3; 4; 6]);
+%! assert (validateattributes (int8 (A), {}, [attr, {"locate", "indices"}]),
+%!         [2; 3; 4; 6]);
+%!test
+%! ## violations across the chunks of the sweep
+%! x = (1:10000)';
+%! x(4097:4098) = -x(4097:4098);
+%! x(end) = NaN;
+%! assert (validateattributes (x, {}, {"positive", "nonnan", "locate",
+%!                                     "indices"}),
+%!         [4097; 4098; 10000]);
+%!test
+%! ## other kinds of input
+%! assert (validateattributes ([1 2; 3 4], {}, {">", [1 3], "locate", "mask"}),
+%!         logical ([1 1; 0 0]));
+%! assert (validateattributes (sparse ([0 -1; 2 0]), {}, {"nonnegative",
+%!                                                       "locate", "indices"}),
+%!         3);
+%! assert (validateattributes (diag ([1 -1]), {}, {"positive", "locate",
+%!                                                 "mask"}),
+%!         logical ([0 1; 1 1]));
+%! assert (validateattributes ([1 1+2i], {}, {"realvalued", "locate",
+%!                                            "indices"}),
+%!         2);
+%! assert (validateattributes (sparse ([0 2; 0 0]), {}, {"positive",
+%!                                                      "locate", "indices"}),
+%!         [1; 2; 4]);
+%! [~, ~, P] = lu (magic (3));
+%! assert (validateattributes (P, {}, {"<", 1, "locate", "indices"}),
+%!         find (P(:)));
+%!test
+%! ## large sparse and diagonal matrices are not made full
+%! A = sparse ([1 1e5], [1 1e5], [-1 2], 1e5, 1e5);
+%! assert (validateattributes (A, {}, {"nonnegative", "locate", "indices"}),
+%!         1);
+%! D = diag ([ones(1e5-1, 1); NaN]);
+%! assert (validateattributes (D, {}, {"nonnan", "locate", "indices"}), 1e10);
+%! [w, s] = validateattributes ([1 NaN], {}, {"nonnan", "locate", "mask"});
+%! assert (w, [false true]);
+%! assert (s.nnan, 1);
+%! old = validateattributes ("level", "off");
+%! unwind_protect
+%!   assert (validateattributes ([1 NaN], {}, {"nonnan", "locate", "mask"}),
+%!           [false false]);
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+%!error <must be finite> validateattributes ([1 Inf], {}, {"finite", "locate", "mask"})
+%!error <must be column> w = validateattributes ([1 NaN], {}, {"column", "nonnan", "locate", "mask"})
+%!error <must be increasing> w = validateattributes ([2 1], {}, {"increasing", "locate", "mask"})
+%!error <LOCATE must be "mask" or "indices"> validateattributes (1, {}, {"locate", "all"})
+%!error <"locate" cannot be combined with "collect"> validateattributes (1, {}, {"locate", "mask", "collect"})
+%!error <"locate" cannot be combined with "async"> validateattributes (1, {}, {"locate", "mask", "async"})
+
+## summary
+%!test
+%! [~, s] = validateattributes ([3 NaN -Inf 0 2], {}, {"real", "nonempty"});
+%! assert (s, struct ("min", -Inf, "max", 3, "nnan", 1, "ninf", 1, "nzero", 1,
+%!                    "nondecreasing", false, "nonincreasing", false));
+%!test
+%! [v, s] = validateattributes (int8 ([-5 0 0 7]), {}, {"positive", "collect"});
+%! assert ({v.attribute}, {"positive"});
+%! assert ({s.min, s.max, s.nzero}, {int8(-5), int8(7), 2});
+%! assert ([s.nondecreasing, s.nonincreasing], [true, false]);
+%!test
+%! [info, s] = validateattributes ((1e5:-1:1)', {}, {"positive", "sample", 10});
+%! assert (info.sampled);
+%! assert ([s.min, s.max, s.nnan, s.ninf, s.nzero], [1, 1e5, 0, 0, 0]);
+%! assert ([s.nondecreasing, s.nonincreasing], [false, true]);
+%!test
+%! [~, s] = validateattributes ("abc", {}, {});
+%! assert ({s.min, s.max}, {97, 99});
+%! [~, s] = validateattributes (single ([]), {}, {});
+%! assert ({s.min, s.nnan, s.nondecreasing}, {[], 0, true});
+%! [~, s] = validateattributes ([1i 0 NaN], {}, {});
+%! assert ({s.min, s.nnan, s.nzero, s.nondecreasing}, {[], 1, 1, []});
+%! [~, s] = validateattributes (sparse (1), {}, {});
+%! assert (isempty (s.nzero));
+%!test
+%! old = validateattributes ("level", "off");
+%! unwind_protect
+%!   [~, s] = validateattributes (1, {}, {"positive"});
+%!   assert (isempty (s.min));
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+*/
+
+// PKG_ADD: autoload ("validateattributes_stats", "validateattributes.oct");
+
+DEFUN_DLD (validateattributes_stats, args, nargout, "-*- texinfo -*-\n\
+@deftypefn  {} {@var{stats} =} validateattributes_stats ()\n\
+@deftypefnx {} {@var{stats} =} validateattributes_stats (\"reset\")\n\
+@deftypefnx {} {} validateattributes_stats (\"on\")\n\
+@deftypefnx {} {} validateattributes_stats (\"off\")\n\
+Query and control the profiling counters of @code{validateattributes}.\n\
 \n\
-@item @qcode{\"nonnan\"}\n\
-No value is a @code{NaN}.\n\
+When enabled with @qcode{\"on\"}, every class check and every attribute\n\
+check is counted per attribute and per class of the validated value.\n\
+When disabled, which is the default, the cost of the counters is a single\n\
+flag test per check.\n\
 \n\
-@item @nospell{@qcode{\"nonnegative\"}}\n\
-All values are non negative.\n\
+Called without arguments, return the counters as a struct array with one\n\
+element for each attribute and class that was seen, and the fields:\n\
 \n\
-@item @qcode{\"nonsparse\"}\n\
-It is not a sparse matrix.\n\
+@table @code\n\
+@item attribute\n\
+Name of the attribute, @qcode{\"(classes)\"} for the class check, or\n\
+@qcode{\"(fused)\"} for the single pass over the values of @var{A} in\n\
+which several element-wise attributes, and the summary of\n\
+@code{validateattributes}, are checked together.  The time of that pass is\n\
+counted in @qcode{\"(fused)\"} only.  The rows of its attributes count\n\
+their calls, elements, and failures, but next to no time.\n\
 \n\
-@item @qcode{\"nonzero\"}\n\
-No value is zero.\n\
+@item class\n\
+Class of the validated value, as returned by @code{class}, or\n\
+@qcode{\"other\"} for the classes not listed separately, such as\n\
+classdef objects.\n\
 \n\
-@item @qcode{\"nrows\"}\n\
-Has exactly as many rows as the next value in @var{attributes}.\n\
+@item complex\n\
+True if the validated value was complex.  Real and complex values of a\n\
+class are counted separately.\n\
 \n\
-@item @qcode{\"numel\"}\n\
-Has exactly as many elements as the next value in @var{attributes}.\n\
+@item calls\n\
+Number of times the check ran.\n\
 \n\
-@item @qcode{\"odd\"}\n\
-All values are odd numbers.\n\
+@item elements\n\
+Total number of elements inspected.  Checks on the shape of the value only\n\
+do not count any.\n\
 \n\
-@item @qcode{\"positive\"}\n\
-All values are positive.\n\
+@item nanoseconds\n\
+Total time spent in the check, including formatting of the error message.\n\
 \n\
-@item @qcode{\"real\"}\n\
-It is a non-complex matrix.\n\
+@item failures\n\
+Number of times the check raised an error.\n\
+@end table\n\
 \n\
-@item @qcode{\"row\"}\n\
-Values are arranged in a single row.\n\
+With @qcode{\"reset\"}, the counters are returned and set back to zero.\n\
+@seealso{validateattributes, profile}\n\
+@end deftypefn ")
+{
+  int nargin = args.length ();
+
+  if (nargin > 1)
+    print_usage ();
+
+  bool reset = false;
+
+  if (nargin == 1)
+    {
+      std::string opt = args(0).xstring_value ("validateattributes_stats: "
+                                               "OPTION must be a string");
+      if (opt == "on" || opt == "off")
+        {
+          stats_enabled.store (opt == "on", std::memory_order_relaxed);
+          return octave_value_list ();
+        }
+      else if (opt == "reset")
+        reset = true;
+      else
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_stats: unknown OPTION %s",
+                       opt.c_str ());
+    }
+
+  auto take = [reset] (std::atomic<uint64_t>& c)
+    {
+      return reset ? c.exchange (0, std::memory_order_relaxed)
+                   : c.load (std::memory_order_relaxed);
+    };
+
+  std::list<octave_value> attr_names, class_names, iscomplex, calls, elements,
+                          nsec, failures;
+
+  for (int row = 0; row < stats_num_rows; row++)
+    {
+      for (int col = 0; col <= btyp_num_types; col++)
+        {
+          stats_counter& c = stats_table[row][col];
+          uint64_t c_calls = take (c.calls);
+
+          if (c_calls == 0)
+            continue;
+
+          attr_names.push_back (row == stats_class_row ? "(classes)"
+                                : row == stats_fused_row ? "(fused)"
+                                : attr_table[row].name);
+          class_names.push_back (stats_class_names[col]);
+          iscomplex.push_back (col == btyp_complex
+                               || col == btyp_float_complex);
+          calls.push_back (static_cast<double> (c_calls));
+          elements.push_back (static_cast<double> (take (c.elements)));
+          nsec.push_back (static_cast<double> (take (c.nsec)));
+          failures.push_back (static_cast<double> (take (c.failures)));
+        }
+    }
+
+  dim_vector dv (1, attr_names.size ());
+  octave_map retval (dv);
+
+  retval.assign ("attribute", Cell (octave_value_list (attr_names)));
+  retval.assign ("class", Cell (octave_value_list (class_names)));
+  retval.assign ("complex", Cell (octave_value_list (iscomplex)));
+  retval.assign ("calls", Cell (octave_value_list (calls)));
+  retval.assign ("elements", Cell (octave_value_list (elements)));
+  retval.assign ("nanoseconds", Cell (octave_value_list (nsec)));
+  retval.assign ("failures", Cell (octave_value_list (failures)));
+
+  return octave_value_list (octave_value (retval));
+}
+
+/*
+%!test
+%! validateattributes_stats ("reset");
+%! validateattributes_stats ("on");
+%! unwind_protect
+%!   validateattributes ([1 2 3], {"numeric"}, {"vector", "increasing"});
+%!   try validateattributes ([1 NaN], {}, {"nonnan"}); end_try_catch
+%!   s = validateattributes_stats ("reset");
+%! unwind_protect_cleanup
+%!   validateattributes_stats ("off");
+%! end_unwind_protect
+%! k = strcmp ({s.attribute}, "increasing");
+%! assert ([s(k).calls, s(k).elements, s(k).failures], [1, 3, 0]);
+%! assert (s(k).class, "double");
+%! assert (s(k).complex, false);
+%! k = strcmp ({s.attribute}, "vector");
+%! assert ([s(k).calls, s(k).elements], [1, 0]);
+%! k = strcmp ({s.attribute}, "nonnan");
+%! assert (s(k).failures, 1);
+%! assert (nnz (strcmp ({s.attribute}, "(classes)")), 1);
+%! assert (isempty (validateattributes_stats ()));
+
+%!test
+%! validateattributes_stats ("reset");
+%! validateattributes ([1 2 3], {"numeric"}, {"vector"});
+%! assert (isempty (validateattributes_stats ()));
+
+%!test
+%! validateattributes_stats ("reset");
+%! validateattributes_stats ("on");
+%! unwind_protect
+%!   validateattributes ([1 2], {}, {"finite"});
+%!   validateattributes (single ([1 2i]), {}, {"finite"});
+%!   s = validateattributes_stats ("reset");
+%! unwind_protect_cleanup
+%!   validateattributes_stats ("off");
+%! end_unwind_protect
+%! assert ({s.class}, {"double", "single"});
+%! assert ([s.complex], [false, true]);
+
+%!test
+%! validateattributes_stats ("reset");
+%! validateattributes_stats ("on");
+%! unwind_protect
+%!   validateattributes (ones (1, 100), {}, {"positive", "finite"});
+%!   try validateattributes ([1 -1], {}, {"positive", "finite"}); end_try_catch
+%!   s = validateattributes_stats ("reset");
+%! unwind_protect_cleanup
+%!   validateattributes_stats ("off");
+%! end_unwind_protect
+%! k = strcmp ({s.attribute}, "(fused)");
+%! assert ([s(k).calls, s(k).elements, s(k).failures], [2, 102, 1]);
+%! k = strcmp ({s.attribute}, "positive");
+%! assert ([s(k).calls, s(k).elements, s(k).failures], [2, 102, 1]);
+
+%!error <Invalid call> validateattributes_stats ("on", "off")
+%!error <unknown OPTION> validateattributes_stats ("bogus")
+*/
+
+// PKG_ADD: autoload ("validateattributes_wait", "validateattributes.oct");
+
+DEFUN_DLD (validateattributes_wait, args, , "-*- texinfo -*-\n\
+@deftypefn {} {} validateattributes_wait (@var{token})\n\
+Wait for the checks started by @code{validateattributes} with the\n\
+@qcode{\"async\"} attribute.\n\
 \n\
-@item @qcode{\"scalar\"}\n\
-It is a scalar.\n\
+Return once the checks of each @var{token} are done, or raise the error\n\
+that @code{validateattributes} would have raised without\n\
+@qcode{\"async\"}.  @var{token} can be an array of tokens, whose errors are\n\
+raised in order once all of them are done.  Each token can only be waited\n\
+for once.  Until then it holds a copy of the validated value.  At most 256\n\
+tokens can be pending; @code{validateattributes} raises an error for more\n\
+until some of them are waited for.\n\
+@seealso{validateattributes}\n\
+@end deftypefn ")
+{
+  if (args.length () != 1)
+    print_usage ();
+
+  NDArray tokens = args(0).xarray_value ("validateattributes_wait: TOKEN "
+                                         "must be numeric");
+
+  std::vector<std::unique_ptr<async_job>> jobs;
+
+  for (octave_idx_type i = 0; i < tokens.numel (); i++)
+    {
+      if (tokens(i) == async_done_token)
+        continue;
+
+      auto it = async_jobs.find (tokens(i));
+      if (it == async_jobs.end ())
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_wait: unknown TOKEN %s",
+                       fmt_value (tokens(i)).c_str ());
+    }
+
+  for (octave_idx_type i = 0; i < tokens.numel (); i++)
+    {
+      auto it = async_jobs.find (tokens(i));
+      if (it != async_jobs.end ())
+        {
+          jobs.push_back (std::move (it->second));
+          async_jobs.erase (it);
+        }
+    }
+
+  for (auto& job : jobs)
+    job->done.wait ();
+
+  for (auto& job : jobs)
+    finish_async (*job);
+
+  return octave_value_list ();
+}
+
+/*
+%!test
+%! x = rand (1000) + 1;
+%! t = validateattributes (x, {"double"}, {"2d", "positive", ">=", 1, "async"});
+%! x(1) = -1;
+%! validateattributes_wait (t);
+%!test
+%! t1 = validateattributes ([1 -2 3], {}, {"async", "positive"});
+%! t2 = validateattributes ([1 2 3], {}, {"async", "positive"});
+%! fail ("validateattributes_wait ([t2 t1])",
+%!       "must be positive \\(first violation: element 2, value -2\\)");
+%! fail ("validateattributes_wait (t1)", "unknown TOKEN");
+%!test
+%! t = validateattributes ([1 NaN], {"char"}, {"nonnan", "async"});
+%! fail ("validateattributes_wait (t)", "char");
+%! t = validateattributes (sparse ([1 -1]), {}, {"async", "row", "positive"});
+%! fail ("validateattributes_wait (t)", "positive");
+%! t = validateattributes ([1 -1], {}, {"async", "nonnegative", "column"});
+%! fail ("validateattributes_wait (t)", "column");
+%! t = validateattributes ([1 -1], {}, {"async", "increasing", "nonnegative"});
+%! fail ("validateattributes_wait (t)", "nonnegative");
+%!test
+%! old = validateattributes ("level", "off");
+%! unwind_protect
+%!   t = validateattributes ([1 -1], {}, {"positive", "async"});
+%!   validateattributes_wait (t);
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+%!test
+%! ## at most 256 tokens are pending, and none is dropped
+%! t = zeros (1, 256);
+%! for i = 1:256
+%!   t(i) = validateattributes (i - 2, {}, {"positive", "async"});
+%! endfor
+%! fail ('validateattributes (1, {}, {"positive", "async"})',
+%!       "wait for them with validateattributes_wait");
+%! fail ("validateattributes_wait (t)", "must be positive");
+%! validateattributes_wait (validateattributes (1, {}, {"positive", "async"}));
+%!error <Invalid call> validateattributes_wait ()
+%!error <unknown TOKEN> validateattributes_wait (-1)
+*/
+
+// PKG_ADD: autoload ("validateattributes_columns", "validateattributes.oct");
+
+DEFUN_DLD (validateattributes_columns, args, , "-*- texinfo -*-\n\
+@deftypefn  {} {} validateattributes_columns (@var{data}, @var{specs})\n\
+@deftypefnx {} {} validateattributes_columns (@var{data}, @var{specs}, @var{func_name})\n\
+Validate the columns of a dataset at once, on all processor cores.\n\
 \n\
-@item @qcode{\"size\"}\n\
-Its size has length equal to the values of the next in @var{attributes}.\n\
-The next value must is an array with the length for each dimension.  To\n\
-ignore the check for a certain dimension, the value of @code{NaN} can be\n\
+@var{data} is a struct whose fields are the columns, or a cell array of\n\
+them.  For a struct, @var{specs} is a struct with a field for each column\n\
+to check, and for a cell array, a cell array with an element for each\n\
+column, empty for those not checked.  Each is a cell array\n\
+@code{@{@var{classes}, @var{attributes}@}} as for\n\
+@code{validateattributes}, whose options also apply.  The attributes\n\
+@qcode{\"async\"}, @qcode{\"collect\"}, and @qcode{\"explain\"} cannot be\n\
 used.\n\
 \n\
-@item @qcode{\"square\"}\n\
-Is a square matrix.\n\
+The error raised is that of @code{validateattributes} for the first column\n\
+that fails, named by its field, or as @qcode{\"column @var{k}\"}, and\n\
+prefixed by @var{func_name} if given.\n\
+\n\
+The value attributes of the columns run in parallel, large columns split\n\
+into chunks, with threads that run out of work taking it from the others.\n\
+Once a column has failed, the checks of the columns after it are dropped.\n\
+@seealso{validateattributes}\n\
+@end deftypefn ")
+{
+  octave_idx_type nargin = args.length ();
+
+  if (nargin < 2 || nargin > 3)
+    print_usage ();
+
+  if (validation_level == level_off)
+    return octave_value_list ();
+
+  std::string func_name;
+  if (nargin > 2)
+    func_name = args(2).xstring_value ("validateattributes_columns: "
+                                       "FUNC_NAME must be a string") + ": ";
+
+  // the columns to check, in order
+  std::vector<octave_value> data;
+  std::vector<octave_value> specs;
+  std::vector<std::string>  names;
+
+  if (args(0).isstruct () && args(0).numel () == 1)
+    {
+      if (! args(1).isstruct () || args(1).numel () != 1)
+        error_with_id ("Octave:invalid-type",
+                       "validateattributes_columns: SPECS must be a struct "
+                       "for a struct DATA");
+
+      octave_scalar_map m_data = args(0).scalar_map_value ();
+      octave_scalar_map m_spec = args(1).scalar_map_value ();
+
+      string_vector keys = m_spec.fieldnames ();
+      for (octave_idx_type i = 0; i < keys.numel (); i++)
+        {
+          if (! m_data.isfield (keys(i)))
+            error_with_id ("Octave:invalid-input-arg",
+                           "validateattributes_columns: no column %s in "
+                           "DATA", keys(i).c_str ());
+        }
+
+      keys = m_data.fieldnames ();
+      for (octave_idx_type i = 0; i < keys.numel (); i++)
+        {
+          if (m_spec.isfield (keys(i)))
+            {
+              data.push_back (m_data.contents (keys(i)));
+              specs.push_back (m_spec.contents (keys(i)));
+              names.push_back (keys(i));
+            }
+        }
+    }
+  else if (args(0).iscell ())
+    {
+      if (! args(1).iscell () || args(1).numel () != args(0).numel ())
+        error_with_id ("Octave:invalid-type",
+                       "validateattributes_columns: SPECS must be a cell "
+                       "array with an element for each column");
+
+      Cell c_data = args(0).cell_value ();
+      Cell c_spec = args(1).cell_value ();
+
+      for (octave_idx_type i = 0; i < c_data.numel (); i++)
+        {
+          if (! c_spec(i).isempty ())
+            {
+              data.push_back (c_data(i));
+              specs.push_back (c_spec(i));
+              names.push_back ("column " + std::to_string (i + 1));
+            }
+        }
+    }
+  else
+    error_with_id ("Octave:invalid-type",
+                   "validateattributes_columns: DATA must be a struct or a "
+                   "cell array");
+
+  // all specs are parsed before any check
+  std::vector<column_check> cols (data.size ());
+
+  for (std::size_t c = 0; c < cols.size (); c++)
+    {
+      column_check& ck = cols[c];
+      Cell          spec;
+
+      if (specs[c].iscell () && specs[c].numel () == 2)
+        spec = specs[c].cell_value ();
+
+      if (spec.numel () != 2 || ! spec(0).iscellstr () || ! spec(1).iscell ())
+        error_with_id ("Octave:invalid-type",
+                       "validateattributes_columns: the spec of %s must be "
+                       "a cell array {CLASSES, ATTRIBUTES}",
+                       names[c].c_str ());
+
+      ck.ov_A    = data[c];
+      ck.err_ini = func_name + names[c];
+      ck.cls     = spec(0).cellstr_value ();
+      ck.spec    = parse_attributes (spec(1).cell_value ());
+
+      if (ck.spec.async || ck.spec.collect || ck.spec.explain
+          || ck.spec.locate != locate_none)
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_columns: \"async\", \"collect\", "
+                       "\"explain\", and \"locate\" cannot be used");
+    }
+
+  std::size_t ncols = 0;
+  while (ncols < cols.size ())
+    {
+      if (! prepare_column (cols[ncols++]))
+        break;
+    }
+  cols.resize (ncols);
+
+  std::vector<column_task> tasks;
+
+  for (std::size_t c = 0; c < cols.size (); c++)
+    {
+      const column_check& ck = cols[c];
+      std::ptrdiff_t      n  = ck.ov_A.numel ();
+
+      if (! ck.fused.empty () || ! ck.monotone.empty ())
+        {
+          for (std::ptrdiff_t lo = 0; lo < n; lo += column_chunk)
+            tasks.push_back ({c, lo, std::min (n, lo + column_chunk), -1,
+                              {}});
+        }
+
+      for (std::size_t i = 0; i < ck.whole.size (); i++)
+        tasks.push_back ({c, 0, n, static_cast<std::ptrdiff_t> (i), {}});
+    }
+
+  // the first column with a failure so far
+  std::atomic<std::size_t> stop (cols.size ());
+  if (! cols.empty () && (! cols.back ().cls_ok || cols.back ().failed))
+    stop = cols.size () - 1;
+
+  run_stealing (tasks.size (), std::thread::hardware_concurrency (),
+                [&] (std::size_t t)
+    {
+      column_task& task = tasks[t];
+
+      if (task.col > stop.load ())
+        return;
+
+      if (run_column_task (cols[task.col], task))
+        {
+          std::size_t s = stop.load ();
+          while (task.col < s && ! stop.compare_exchange_weak (s, task.col))
+            ;
+        }
+    });
+
+  finish_columns (cols, tasks);
+
+  return octave_value_list ();
+}
+
+/*
+%!shared d, s
+%! d.id = int32 (1:10)';
+%! d.x = rand (3e6, 1) + 1;
+%! d.key = ["ab"; "cd"];
+%! s.id = {{"int32"}, {"column", "increasing", "positive"}};
+%! s.x = {{"double"}, {"column", "positive", "finite", "<", 2}};
+%! s.key = {{"char"}, {"ncols", 2}};
+%!test
+%! validateattributes_columns (d, s);
+%! validateattributes_columns (struct2cell (d), struct2cell (s));
+%! validateattributes_columns (d, struct ("x", {s.x}));
+%!test
+%! e = d;
+%! e.x(2e6) = -1;
+%! fail ("validateattributes_columns (e, s)",
+%!       "x must be positive \\(first violation: element 2000000, value -1\\)");
+%! fail ("validateattributes_columns (e, s, 'fcn')", "fcn: x must be positive");
+%! validateattributes_columns (e, rmfield (s, "x"));
+%!test
+%! x = (1:3e6)';
+%! x(1048577) = x(1048576);
+%! fail ("validateattributes_columns ({x}, {{{}, {'increasing'}}})",
+%!       "column 1 must be increasing \\(first violation: element 1048577");
+%!test
+%! c = {ones(1e6, 1), [1 -1], NaN, sparse([1 -1])};
+%! fail ("validateattributes_columns (c, {{}, {{}, {'positive'}}, {{}, {'nonnan'}}, {}})",
+%!       "column 2 must be positive");
+%! fail ("validateattributes_columns (c, {{{}, {'nonnan'}}, {}, {{}, {'nonnan'}}, {}})",
+%!       "column 3 must be nonnan");
+%! fail ("validateattributes_columns (c, {{{}, {'finite'}}, {}, {{}, {'finite'}}, {{}, {'positive'}}})",
+%!       "column 3 must be finite");
+%! fail ("validateattributes_columns (c, {{{}, {'positive'}}, {}, {}, {{}, {'positive'}}})",
+%!       "column 4 must be positive");
+%! fail ("validateattributes_columns (c, {{{'single'}, {'positive'}}, {{}, {'positive'}}, {}, {}})",
+%!       "column 1 must be of class");
+%!test
+%! old = validateattributes ("level", "off");
+%! unwind_protect
+%!   validateattributes_columns ({-1}, {{{}, {"positive"}}});
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+%!error <Invalid call> validateattributes_columns ({1})
+%!error <must be a struct or a cell> validateattributes_columns (1, {})
+%!error <SPECS must be a struct> validateattributes_columns (struct ("a", 1), {})
+%!error <no column b> validateattributes_columns (struct ("a", 1), struct ("b", {{{}, {}}}))
+%!error <an element for each column> validateattributes_columns ({1, 2}, {{{}, {}}})
+%!error <spec of column 1> validateattributes_columns ({1}, {{"positive"}})
+%!error <cannot be used> validateattributes_columns ({1}, {{{}, {"collect"}}})
+%!error <cannot be used> validateattributes_columns ({1}, {{{}, {"locate", "mask"}}})
+%!error <unknown attribute> validateattributes_columns ({1, -1}, {{{}, {"bogus"}}, {{}, {"positive"}}})
+*/
+
+// The options of validatestring as a case-insensitive prefix trie.  Each
+// node is a prefix, reached by its lower case characters, of COUNT of the
+// options.  A string of the same length as the node's prefix matches all of
+// them, and so is unambiguous if the first of the shortest among them,
+// SHORTEST, is itself a prefix of all others, which is when the node where
+// it ends has the same COUNT.
+struct string_trie
+{
+  struct node
+  {
+    std::vector<std::pair<unsigned char, int>> next;  // sorted by character
+    octave_idx_type count    = 0;
+    octave_idx_type shortest = -1;
+    bool            unique   = false;
+  };
+
+  Cell                     cell;  // as last seen by validatestring
+  std::uint64_t            hash;  // see string_trie_hash
+  Array<std::string>       options;
+  std::vector<node>        nodes;
+};
+
+static int
+trie_next (const string_trie& trie, int n, unsigned char c)
+{
+  const auto& next = trie.nodes[n].next;
+  auto it = std::lower_bound (next.begin (), next.end (),
+                              std::make_pair (c, 0));
+  return (it != next.end () && it->first == c ? it->second : -1);
+}
+
+static std::shared_ptr<string_trie>
+make_string_trie (const Array<std::string>& options)
+{
+  auto trie = std::make_shared<string_trie> ();
+  trie->hash = 0;
+  trie->options = options;
+  trie->nodes.resize (1);
+
+  std::vector<int> ends (options.numel ());
+
+  for (octave_idx_type i = 0; i < options.numel (); i++)
+    {
+      const std::string& opt = options(i);
+      int n = 0;
+
+      for (std::size_t k = 0; ; k++)
+        {
+          string_trie::node& nd = trie->nodes[n];
+          nd.count++;
+          if (nd.shortest < 0 || opt.length () < options(nd.shortest).length ())
+            nd.shortest = i;
+
+          if (k == opt.length ())
+            break;
+
+          unsigned char c = std::tolower (static_cast<unsigned char> (opt[k]));
+          int m = trie_next (*trie, n, c);
+          if (m < 0)
+            {
+              m = trie->nodes.size ();
+              auto& next = trie->nodes[n].next;
+              next.insert (std::lower_bound (next.begin (), next.end (),
+                                             std::make_pair (c, 0)),
+                           std::make_pair (c, m));
+              trie->nodes.emplace_back ();
+            }
+          n = m;
+        }
+
+      ends[i] = n;
+    }
+
+  for (string_trie::node& nd : trie->nodes)
+    nd.unique = (nd.shortest >= 0
+                 && trie->nodes[ends[nd.shortest]].count == nd.count);
+
+  return trie;
+}
+
+// Option sets compiled by validatestring, most recently used first.  The
+// cell array they were last seen in is held, so that it cannot change, and
+// is recognized by its data alone.  Another cell array with the same
+// options, as a literal one is on every evaluation, is recognized by a hash
+// of the options, which are compared in full only when the hash matches.
+static const std::size_t string_trie_cache_size = 16;
+
+static std::list<std::shared_ptr<string_trie>> string_trie_cache;
+
+// FNV-1a over the length and characters of each option.
+static std::uint64_t
+string_trie_hash (const Cell& strarray)
+{
+  std::uint64_t h = 14695981039346656037ULL;
+  auto mix = [&h] (unsigned char c) { h = (h ^ c) * 1099511628211ULL; };
+
+  for (octave_idx_type i = 0; i < strarray.numel (); i++)
+    {
+      charNDArray str = strarray(i).char_array_value ();
+      std::uint64_t n = str.numel ();
+      for (std::size_t b = 0; b < sizeof (n); b++)
+        mix (static_cast<unsigned char> (n >> (8 * b)));
+      for (octave_idx_type k = 0; k < str.numel (); k++)
+        mix (static_cast<unsigned char> (str.xelem (k)));
+    }
+
+  return h;
+}
+
+// Whether STRARRAY holds the options of TRIE, each as a row.
+static bool
+same_options (const string_trie& trie, const Cell& strarray)
+{
+  if (trie.options.numel () != strarray.numel ())
+    return false;
+
+  for (octave_idx_type i = 0; i < strarray.numel (); i++)
+    {
+      charNDArray str = strarray(i).char_array_value ();
+      const std::string& opt = trie.options(i);
+      if (str.ndims () != 2 || str.rows () > 1
+          || std::size_t (str.numel ()) != opt.length ()
+          || ! std::equal (opt.begin (), opt.end (), str.data ()))
+        return false;
+    }
+
+  return true;
+}
+
+static std::shared_ptr<const string_trie>
+find_string_trie (const Cell& strarray)
+{
+  auto hit = [&strarray] (std::list<std::shared_ptr<string_trie>>::iterator it)
+  {
+    string_trie_cache.splice (string_trie_cache.begin (), string_trie_cache,
+                              it);
+    (*it)->cell = strarray;
+    return *it;
+  };
+
+  for (auto it = string_trie_cache.begin (); it != string_trie_cache.end ();
+       it++)
+    if ((*it)->cell.data () == strarray.data ()
+        && (*it)->cell.numel () == strarray.numel ())
+      return hit (it);
+
+  std::uint64_t hash = string_trie_hash (strarray);
+
+  for (auto it = string_trie_cache.begin (); it != string_trie_cache.end ();
+       it++)
+    if ((*it)->hash == hash && same_options (**it, strarray))
+      return hit (it);
+
+  std::shared_ptr<string_trie> trie
+    = make_string_trie (strarray.cellstr_value ());
+  trie->cell = strarray;
+  trie->hash = hash;
+
+  string_trie_cache.push_front (trie);
+  if (string_trie_cache.size () > string_trie_cache_size)
+    string_trie_cache.pop_back ();
+
+  return trie;
+}
+
+// The options in TRIE which STR is a prefix of, one per line, for the error
+// messages.
+static std::string
+string_matches (const string_trie& trie, const std::string& str)
+{
+  std::string list;
+  for (octave_idx_type i = 0; i < trie.options.numel (); i++)
+    {
+      const std::string& opt = trie.options(i);
+      bool match = (opt.length () >= str.length ());
+      for (std::size_t k = 0; k < str.length () && match; k++)
+        match = (std::tolower (static_cast<unsigned char> (str[k]))
+                 == std::tolower (static_cast<unsigned char> (opt[k])));
+
+      if (match)
+        list += (list.empty () ? "" : "\n") + opt;
+    }
+  return list;
+}
+
+// PKG_ADD: autoload ("validatestring", "validateattributes.oct");
+
+DEFUN_DLD (validatestring, args, , "-*- texinfo -*-\n\
+@deftypefn  {} {@var{validstr} =} validatestring (@var{str}, @var{strarray})\n\
+@deftypefnx {} {@var{validstr} =} validatestring (@dots{}, @var{funcname})\n\
+@deftypefnx {} {@var{validstr} =} validatestring (@dots{}, @var{funcname}, @var{varname})\n\
+@deftypefnx {} {@var{validstr} =} validatestring (@dots{}, @var{position})\n\
+Verify that @var{str} is an element, or the start of an element, of\n\
+@var{strarray}.\n\
 \n\
-@item @qcode{\"vector\"}\n\
-Values are arranged in a single vector (column or vector).\n\
+The comparison ignores case.  If @var{str} is the start of a single element\n\
+of the cell array of strings @var{strarray}, that element is returned.  If\n\
+it is the start of several, the shortest of them is returned if it is also\n\
+the start of all the others, otherwise the choice is ambiguous.  An error is\n\
+raised if there is no match, with identifier\n\
+@qcode{\"Octave:unrecognized-string-choice\"}, or if the choice is\n\
+ambiguous, with identifier @qcode{\"Octave:ambiguous-string-choice\"}.\n\
 \n\
-@end table\n\
+The optional @var{funcname}, @var{varname}, and @var{position} are used in\n\
+the error message as by @code{validateattributes}.\n\
 \n\
-@seealso{isa, validatestring, inputParser}\n\
+Each @var{strarray} is prepared for matching once, and the last few are\n\
+remembered.  Matching against the same cell array again, as when it is\n\
+held in a variable, takes time in the length of @var{str} only.  Matching\n\
+against an equal cell array, such as a literal one evaluated again, also\n\
+reads the options once to recognize them.\n\
+@seealso{validateattributes, strncmpi, inputParser}\n\
 @end deftypefn ")
 {
+  octave_idx_type nargin = args.length ();
 
-  octave_value       ov_A;
-  octave_value       ov_cls;
-  octave_value       ov_attr;
+  if (nargin < 2 || nargin > 5)
+    print_usage ();
 
-  std::string        A_class;
-  Array<std::string> cls;
-  Cell               attr;
+  octave_idx_type nopt     = nargin;
+  octave_idx_type position = 0;
 
-  std::string        err_ini;
-  std::string        func_name;
+  if (nargin > 2 && args(nargin-1).isnumeric ())
+    {
+      position = args(nargin-1).idx_type_value ();
+      nopt--;
+    }
 
-  std::string        var_name = "input";
-  octave_idx_type    nargin   = args.length ();
+  std::string func_name;
+  std::string var_name;
 
-  if (nargin < 3 || nargin > 6)
-    print_usage ();
+  int nchar = 0;
+  for (octave_idx_type i = 2; i < nopt; i++)
+    {
+      if (! args(i).is_string ())
+        error ("validatestring: FUNCNAME and VARNAME must be strings");
+      else if (++nchar == 1)
+        func_name = args(i).string_value ();
+      else if (nchar == 2)
+        var_name = args(i).string_value ();
+      else
+        error ("validatestring: invalid number of character inputs (3)");
+    }
 
-  ov_A    = args(0);
-  ov_cls  = args(1);
-  ov_attr = args(2);
+  if (! args(0).is_string ())
+    error_with_id ("Octave:invalid-type",
+                   "validatestring: STR must be a character string");
+  else if (! args(0).isempty ()
+           && (args(0).rows () != 1 || args(0).ndims () != 2))
+    error_with_id ("Octave:invalid-type",
+                   "validatestring: STR must be a single row vector");
+  else if (! args(1).iscellstr ())
+    error_with_id ("Octave:invalid-type",
+                   "validatestring: STRARRAY must be a cellstr");
+  else if (position < 0)
+    error_with_id ("Octave:invalid-input-arg",
+                   "validatestring: POSITION must be >= 0");
 
-  if (! ov_cls.iscellstr ())
+  // an empty STR is the start of every option, but, as strncmpi has it,
+  // matches none of them
+  std::string str = (args(0).isempty () ? "" : args(0).string_value ());
+
+  std::shared_ptr<const string_trie> trie
+    = find_string_trie (args(1).cell_value ());
+
+  int n = 0;
+  for (std::size_t k = 0; k < str.length () && n >= 0; k++)
+    n = trie_next (*trie, n,
+                   std::tolower (static_cast<unsigned char> (str[k])));
+
+  if (n > 0 && trie->nodes[n].unique)
+    return octave_value_list (octave_value (
+                                trie->options(trie->nodes[n].shortest)));
+
+  std::string err_ini;
+  if (! func_name.empty ())
+    err_ini = func_name + ": ";
+  if (! var_name.empty ())
+    err_ini += var_name + " ";
+  else
+    err_ini += "'" + str + "' ";
+  if (position > 0)
+    err_ini += "(argument #" + std::to_string (position) + ") ";
+
+  if (n <= 0)
     {
-      error_with_id (
-          "Octave:invalid-type",
-          "validateattributes: CLASSES must be a cell array of strings");
+      std::string list = string_matches (*trie, "");
+      error_with_id ("Octave:unrecognized-string-choice",
+                     "%sdoes not match any valid string:\n%s",
+                     err_ini.c_str (), list.c_str ());
     }
-  else if (! ov_attr.iscell ())
+
+  std::string list = string_matches (*trie, str);
+  error_with_id ("Octave:ambiguous-string-choice",
+                 "%sallows multiple unique matches:\n%s",
+                 err_ini.c_str (), list.c_str ());
+}
+
+/*
+%!assert (validatestring ("app", {"apple", "banana"}), "apple")
+%!assert (validatestring ("APP", {"Apple", "banana"}), "Apple")
+%!assert (validatestring ("r", {"red", "reddish"}), "red")
+%!assert (validatestring ("red", {"reddish", "red"}), "red")
+%!assert (validatestring ("b", {"apple", "banana"}), "banana")
+%!test
+%! opts = {"linear", "nearest", "pchip", "cubic", "spline"};
+%! for i = 1:3
+%!   assert (validatestring ("near", opts), "nearest");
+%!   assert (validatestring ("Spl", opts), "spline");
+%! endfor
+%!test
+%! opts = {"apple", "banana"};
+%! assert (validatestring ("a", opts), "apple");
+%! opts{1} = "cherry";
+%! assert (validatestring ("c", opts), "cherry");
+%! assert (validatestring ("b", opts(2)), "banana");
+%! assert (validatestring ("a", {"Apple", "banana"}), "Apple");
+
+%!error <'xyz' does not match any valid string:\napple\nbanana> validatestring ("xyz", {"apple", "banana"})
+%!error <'ab' allows multiple unique matches:\nabc\nabd> validatestring ("ab", {"abc", "x", "abd"})
+%!error <myfunc: color \(argument #2\) does not match> validatestring ("x", {"red"}, "myfunc", "color", 2)
+%!error <myfunc: 'x' does not match> validatestring ("x", {"red"}, "myfunc")
+%!error <does not match> validatestring ("apples", {"apple"})
+%!error <Invalid call> validatestring ("a")
+%!error <STR must be a character string> validatestring (1, {"a"})
+%!error <STR must be a single row vector> validatestring (["a"; "b"], {"a"})
+%!error <'' does not match any valid string> validatestring ("", {"a"})
+%!error <FUNCNAME and VARNAME must be strings> validatestring ("a", {"a"}, {"f"})
+%!error <FUNCNAME and VARNAME must be strings> validatestring ("a", {"a"}, 1, "f")
+%!error <STRARRAY must be a cellstr> validatestring ("a", {1})
+%!error <POSITION must be> validatestring ("a", {"a"}, -1)
+%!test
+%! try validatestring ("a", {"ab", "ac"});
+%! catch id
+%! end_try_catch
+%! assert (getfield (id, "identifier"), "Octave:ambiguous-string-choice");
+%! try validatestring ("z", {"ab", "ac"});
+%! catch id
+%! end_try_catch
+%! assert (getfield (id, "identifier"), "Octave:unrecognized-string-choice");
+*/
+
+// Argument schemas compiled by validateattributes_schema, by token.
+
+enum schema_kind
+{
+  schema_required,
+  schema_optional,
+  schema_parameter
+};
+
+// An attribute that compares an argument with the argument ARG: its size
+// or class, or its count CODE of dimensions with the count OF of ARG.
+struct arg_ref
+{
+  attr_code   code;
+  attr_code   of;
+  std::size_t arg;  // index into arg_schema::args
+};
+
+struct schema_arg
+{
+  schema_kind          kind;
+  std::string          name;
+  octave_value         def;
+  Array<std::string>   cls;
+  attr_spec            spec;
+  std::vector<arg_ref> refs;  // resolved from SPEC.refs
+};
+
+struct arg_schema
+{
+  std::string                         func_name;
+  std::vector<schema_arg>             args;    // in the order of DEFS
+  std::vector<std::size_t>            params;  // indices into ARGS
+  std::shared_ptr<const string_trie>  param_names;
+};
+
+static std::map<double, std::unique_ptr<const arg_schema>> arg_schemas;
+
+static double arg_schema_last_token = 0;
+
+// The start of the parser's own error messages.
+static std::string
+schema_err_ini (const arg_schema& schema)
+{
+  return (schema.func_name.empty () ? "validateattributes_parse"
+                                    : schema.func_name);
+}
+
+// The count CODE ("numel", "ncols", "nrows", or "ndims") of DIMS.
+static octave_idx_type
+dims_count (attr_code code, const dim_vector& dims)
+{
+  switch (code)
     {
-      error_with_id ("Octave:invalid-type",
-                   "validateattributes: ATTRIBUTES must be a cell array");
+      case attr_numel:
+        return dims.numel ();
+      case attr_ncols:
+        return dims(1);
+      case attr_nrows:
+        return dims(0);
+      default:
+        return dims.ndims ();
     }
+}
 
-  cls  = ov_cls.cellstr_value ();
-  attr = ov_attr.cell_value ();
+static const char *
+count_noun (attr_code code)
+{
+  switch (code)
+    {
+      case attr_numel:
+        return "elements";
+      case attr_ncols:
+        return "columns";
+      case attr_nrows:
+        return "rows";
+      default:
+        return "dimensions";
+    }
+}
 
-  if (nargin > 3)
+// Resolve OP, from the attributes of the argument named NAME, to the index
+// of the argument it refers to.  The value of OP names that argument or
+// gives its position in SCHEMA, and for a count it is "COUNT(ARG)".
+static arg_ref
+resolve_ref (const arg_schema& schema, const std::string& name,
+             const attr_op& op)
+{
+  arg_ref      ref { op.code, op.code, 0 };
+  octave_value target = op.val;
+
+  if (attr_table[op.code].kind != kind_ref)
     {
-      if (args(3).is_string ())
+      std::string str  = op.val.string_value ();
+      std::size_t open = str.find ('(');
+
+      ref.of = attr_unknown;
+      if (open != std::string::npos && str.back () == ')')
+        ref.of = attr_lookup (str.substr (0, open));
+
+      if (ref.of != attr_numel && ref.of != attr_ncols
+          && ref.of != attr_nrows && ref.of != attr_ndims)
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_schema: %s of \"%s\" must be "
+                       "\"numel\", \"ncols\", \"nrows\", or \"ndims\" "
+                       "of an argument, as in \"ncols(x)\"",
+                       op.name.c_str (), name.c_str ());
+
+      str = str.substr (open + 1, str.length () - open - 2);
+      if (! str.empty ()
+          && str.find_first_not_of ("0123456789") == std::string::npos)
+        target = octave_value (std::stod (str));
+      else
+        target = octave_value (str);
+    }
+
+  if (target.is_string ())
+    {
+      std::string arg_name = target.string_value ();
+      for (ref.arg = 0; ref.arg < schema.args.size (); ref.arg++)
+        if (schema.args[ref.arg].name == arg_name)
+          return ref;
+    }
+  else if (is_valid_idx (target)
+           && target.idx_type_value () <= octave_idx_type (schema.args.size ()))
+    {
+      ref.arg = target.idx_type_value () - 1;
+      return ref;
+    }
+
+  error_with_id ("Octave:invalid-input-arg",
+                 "validateattributes_schema: %s of \"%s\" refers to an "
+                 "unknown argument", op.name.c_str (), name.c_str ());
+}
+
+// Check the attributes of argument I of SCHEMA that refer to other
+// arguments.  VALS holds the values given, and is undefined for the
+// arguments left out, which are compared by their default values.
+static void
+chk_schema_refs (const arg_schema& schema, std::size_t i,
+                 const std::vector<octave_value>& vals)
+{
+  const schema_arg&   arg = schema.args[i];
+  const octave_value& val = vals[i];
+
+  std::string err_ini = (schema.func_name.empty () ? ""
+                                                   : schema.func_name + ": ")
+                        + arg.name;
+
+  for (const arg_ref& ref : arg.refs)
+    {
+      const schema_arg&   other     = schema.args[ref.arg];
+      const octave_value& other_val = (vals[ref.arg].is_defined ()
+                                       ? vals[ref.arg] : other.def);
+
+      if (ref.code == attr_sizeas)
         {
-          func_name = args(3).string_value () + ": ";
+          if (val.dims () != other_val.dims ())
+            error_with_id ("Octave:incorrect-size",
+                           "%s must be of size %s like %s but was %s",
+                           err_ini.c_str (),
+                           other_val.dims ().str ().c_str (),
+                           other.name.c_str (), val.dims ().str ().c_str ());
         }
-      else if (nargin == 4 && is_valid_idx (args(3)))
+      else if (ref.code == attr_classas)
         {
-          var_name = "input " + std::to_string (args(3).idx_type_value ());
+          if (val.class_name () != other_val.class_name ())
+            error_with_id ("Octave:invalid-type",
+                           "%s must be of class %s like %s but was %s",
+                           err_ini.c_str (),
+                           other_val.class_name ().c_str (),
+                           other.name.c_str (), val.class_name ().c_str ());
         }
       else
         {
-          error_with_id ("Octave:invalid-input-arg",
-                       "validateattributes: 4th input argument must be "
-                       "ARG_IDX or FUNC_NAME");
-        }
-
-      if (nargin > 4)
-        {
-          if (! args(4).is_string ())
-            {
-              error_with_id ("Octave:invalid-type",
-                           "validateattributes: VAR_NAME must be a string");
-            }
-          var_name = args(4).string_value ();
+          octave_idx_type n = dims_count (ref.of, other_val.dims ());
 
-          if (nargin > 5)
-            {
-              if (! is_valid_idx (args(5)))
-                {
-                  error_with_id ("Octave:invalid-input-arg",
-                               "validateattributes: ARG_IDX must be a "
-                               "positive integer");
-                }
-              var_name += " (argument #"
-                          + std::to_string (args(5).idx_type_value ()) + ")";
-            }
+          if (dims_count (ref.code, val.dims ()) != n)
+            error_with_id ((ref.code == attr_numel ? "Octave:incorrect-numel"
+                            : ref.code == attr_ncols ? "Octave:incorrect-numcols"
+                            : ref.code == attr_nrows ? "Octave:incorrect-numrows"
+                            : "Octave:incorrect-numdims"),
+                           "%s must have %s %s, the number of %s of %s",
+                           err_ini.c_str (), std::to_string (n).c_str (),
+                           count_noun (ref.code), count_noun (ref.of),
+                           other.name.c_str ());
         }
     }
+}
 
-  err_ini = func_name + var_name;
+// Check VAL against ARG, as validateattributes would.
+static void
+chk_schema_arg (const arg_schema& schema, const schema_arg& arg,
+                const octave_value& val, octave::profiler& prof)
+{
+  if (validation_level == level_off)
+    return;
 
-  if (! cls.isempty () && ! chk_class (ov_A, cls))
-    {
-      cls_error (err_ini, cls, ov_A.class_name ());
-    }
+  std::string err_ini = (schema.func_name.empty () ? ""
+                                                   : schema.func_name + ": ")
+                        + arg.name;
 
-  chk_attributes (ov_A, attr, err_ini);
+  if (! arg.cls.isempty () && ! chk_class (val, arg.cls))
+    cls_error (err_ini, arg.cls, val.class_name ());
 
-  return octave_value_list ();
+  chk_attributes (val, arg.spec, err_ini, prof);
 }
 
-/*
-%!error <double> validateattributes (rand (5), {"uint8"}, {})
-%!error <single> validateattributes (uint8 (rand (5)), {"float"}, {})
-%!error <2d> validateattributes (rand (5, 5, 5), {}, {"2d"})
-%!error <3d> validateattributes (rand (5, 5, 5, 7), {}, {"3d"})
-%!error <column> validateattributes (rand (5, 5), {}, {"column"})
-%!error <column> validateattributes (rand (1, 5), {}, {"column"})
-%!error <row> validateattributes (rand (5, 5), {}, {"row"})
-%!error <row> validateattributes (rand (5, 1), {}, {"row"})
-%!error <scalar> validateattributes (rand (1, 5), {}, {"scalar"})
-%!error <vector> validateattributes (rand (5), {}, {"vector"})
-%!error <square> validateattributes (rand (5, 6), {}, {"square"})
-%!error <nonempty> validateattributes ([], {}, {"nonempty"})
-%!error <nonsparse> validateattributes (sparse(rand(5)), {}, {"nonsparse"})
-%!error <binary> validateattributes ("text", {}, {"binary"})
-%!error <binary> validateattributes ([0 1 0 3 0], {}, {"binary"})
-%!error <even> validateattributes ([2 3 6 8], {}, {"even"})
-%!error <even> validateattributes ([2 NaN], {}, {"even"})
-%!error <odd> validateattributes ([3 4 7 5], {}, {"odd"})
-%!error <odd> validateattributes ([5 NaN], {}, {"odd"})
-%!error <integer> validateattributes ([5 5.2 5.7], {}, {"integer"})
-%!error <real> validateattributes ([5i 8 9], {}, {"real"})
-%!error <finite> validateattributes ([5i Inf 8], {}, {"finite"})
-%!error <nonnan> validateattributes ([NaN Inf 8], {}, {"nonnan"})
-%!error <nonnegative> validateattributes ([7 8 -9], {}, {"nonnegative"})
-%!error <nonzero> validateattributes ([7 8 0], {}, {"nonzero"})
-%!error <positive> validateattributes ([7 0 8], {}, {"positive"})
-%!error <decreasing> validateattributes ([7 8 4 3 -5], {}, {"decreasing"})
-%!error <decreasing> validateattributes ([7 NaN 4 3 -5], {}, {"decreasing"})
-%!error <increasing> validateattributes ([7 8 4 9 20], {}, {"increasing"})
-%!error <increasing> validateattributes ([7 8 NaN 9 20], {}, {"increasing"})
-%!error <nonincreasing> validateattributes ([7 8 4 9 20], {}, {"nonincreasing"})
-%!error <nonincreasing> validateattributes ([7 8 NaN 9 20], {}, {"nonincreasing"})
-%!error <nondecreasing> validateattributes ([7 8 4 3 -5], {}, {"nondecreasing"})
-%!error <nondecreasing> validateattributes ([7 NaN 4 3 -5], {}, {"nondecreasing"})
-%!error <size> validateattributes (ones (5, 3, 6), {}, {"size", [5 4 7]})
-%!error <size> validateattributes (ones (5, 3, 6), {}, {"size", [5 NaN 7]})
-%!error <size> validateattributes (ones (5, 3, 6), {}, {"size", [5 3 6 2]})
-%!error <elements> validateattributes (ones (6, 3), {}, {"numel", 12})
-%!error <columns> validateattributes (ones (6, 2), {}, {"ncols", 3})
-%!error <rows> validateattributes (ones (6, 2), {}, {"nrows", 3})
-%!error <dimensions> validateattributes (ones (6, 2, 6, 3), {}, {"ndims", 3})
-%!error <greater than> validateattributes ([6 7 8 5], {}, {">", 5})
-%!error <greater than> validateattributes ([6 7 8 5], {}, {">=", 6})
-%!error <less than> validateattributes ([6 7 8 5], {}, {"<", 8})
-%!error <less than> validateattributes ([6 7 8 5], {}, {"<=", 7})
-%!error <diag> validateattributes ([0 0 0; 0 0 0; 1 0 0], {}, {"diag"})
-%!error <diag> validateattributes (repmat (eye (3), [1 1 3]), {}, {"diag"})
+// PKG_ADD: autoload ("validateattributes_schema", "validateattributes.oct");
+
+DEFUN_DLD (validateattributes_schema, args, , "-*- texinfo -*-\n\
+@deftypefn {} {@var{schema} =} validateattributes_schema (@var{func_name}, @var{defs})\n\
+Compile the arguments of a function for @code{validateattributes_parse}.\n\
+\n\
+@var{defs} is a cell array with a row for each argument, in the order they\n\
+are passed, and five columns: the kind of argument, its name, its default\n\
+value, and the @var{classes} and @var{attributes} its value is checked\n\
+against, as by @code{validateattributes}.  The kind is one of:\n\
+\n\
+@table @asis\n\
+@item @qcode{\"required\"}\n\
+A positional argument that must be given.  Its default value is ignored.\n\
+\n\
+@item @qcode{\"optional\"}\n\
+A positional argument after the required ones, which may be left out.\n\
+\n\
+@item @qcode{\"parameter\"}\n\
+A name/value pair, after the positional arguments.  Names are matched as by\n\
+@code{validatestring}.\n\
+@end table\n\
+\n\
+The attributes of an argument may also compare it with another argument\n\
+@var{arg}, given by its name or its position in @var{defs}.  These are\n\
+checked from the dimensions and classes of the arguments once all are\n\
+matched, with the default value of an argument that was left out:\n\
+\n\
+@table @asis\n\
+@item @qcode{\"sizeas\"}, @var{arg}\n\
+Has the same size as @var{arg}.\n\
+\n\
+@item @qcode{\"classas\"}, @var{arg}\n\
+Is of the same class as @var{arg}.\n\
+\n\
+@item @var{count}, @qcode{\"@var{of}(@var{arg})\"}\n\
+Where @var{count} and @var{of} are each @qcode{\"numel\"},\n\
+@qcode{\"ncols\"}, @qcode{\"nrows\"}, or @qcode{\"ndims\"}: has as many\n\
+elements, columns, rows, or dimensions as @var{arg} has of @var{of}.  For\n\
+example, @qcode{\"nrows\", \"ncols(1)\"} requires as many rows as the\n\
+first argument has columns.\n\
+@end table\n\
+\n\
+The options @qcode{\"async\"}, @qcode{\"collect\"}, @qcode{\"explain\"},\n\
+and @qcode{\"locate\"} of @code{validateattributes} cannot be used.\n\
+\n\
+@var{func_name} starts the error messages.  The returned @var{schema} is a\n\
+token that stays valid until the oct-file is cleared.\n\
+\n\
+@example\n\
+@group\n\
+persistent schema = validateattributes_schema (\"myfun\", @{\n\
+  \"required\",  \"x\",   [],   @{\"numeric\"@}, @{\"vector\"@};\n\
+  \"optional\",  \"n\",   10,   @{\"numeric\"@}, @{\"positive\"@};\n\
+  \"parameter\", \"Tol\", 1e-6, @{\"double\"@},  @{\">\", 0@}@});\n\
+opts = validateattributes_parse (schema, varargin@{:@});\n\
+@end group\n\
+@end example\n\
+@seealso{validateattributes_parse, validateattributes, inputParser}\n\
+@end deftypefn ")
+{
+  if (args.length () != 2)
+    print_usage ();
+
+  std::string func_name = args(0).xstring_value ("validateattributes_schema: "
+                                                 "FUNC_NAME must be a string");
+
+  if (! args(1).iscell () || args(1).columns () != 5 || args(1).ndims () != 2)
+    error_with_id ("Octave:invalid-type",
+                   "validateattributes_schema: DEFS must be a cell array "
+                   "with 5 columns");
+
+  Cell defs = args(1).cell_value ();
+
+  auto schema = std::make_unique<arg_schema> ();
+  schema->func_name = func_name;
+
+  Array<std::string> param_names (dim_vector (0, 1));
+
+  for (octave_idx_type i = 0; i < defs.rows (); i++)
+    {
+      schema_arg arg;
+
+      std::string kind = defs(i, 0).xstring_value ("validateattributes_schema: "
+                                                   "kind of argument %ld must "
+                                                   "be a string",
+                                                   static_cast<long> (i + 1));
+      if (kind == "required")
+        arg.kind = schema_required;
+      else if (kind == "optional")
+        arg.kind = schema_optional;
+      else if (kind == "parameter")
+        arg.kind = schema_parameter;
+      else
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_schema: unknown kind \"%s\" of "
+                       "argument %ld", kind.c_str (),
+                       static_cast<long> (i + 1));
+
+      if (! schema->args.empty () && arg.kind < schema->args.back ().kind)
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_schema: \"%s\" argument %ld after "
+                       "one of kind \"%s\"", kind.c_str (),
+                       static_cast<long> (i + 1),
+                       schema->args.back ().kind == schema_optional
+                       ? "optional" : "parameter");
+
+      arg.name = defs(i, 1).xstring_value ("validateattributes_schema: name "
+                                           "of argument %ld must be a string",
+                                           static_cast<long> (i + 1));
+      if (! octave::valid_identifier (arg.name))
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_schema: invalid name \"%s\"",
+                       arg.name.c_str ());
+
+      for (const schema_arg& prev : schema->args)
+        if (prev.name == arg.name)
+          error_with_id ("Octave:invalid-input-arg",
+                         "validateattributes_schema: duplicate name \"%s\"",
+                         arg.name.c_str ());
+
+      arg.def = defs(i, 2);
+
+      if (! defs(i, 3).iscellstr ())
+        error_with_id ("Octave:invalid-type",
+                       "validateattributes_schema: CLASSES of \"%s\" must be "
+                       "a cell array of strings", arg.name.c_str ());
+      else if (! defs(i, 4).iscell ())
+        error_with_id ("Octave:invalid-type",
+                       "validateattributes_schema: ATTRIBUTES of \"%s\" must "
+                       "be a cell array", arg.name.c_str ());
+
+      arg.cls  = defs(i, 3).cellstr_value ();
+      arg.spec = parse_attributes (defs(i, 4).cell_value (), true);
+
+      const char *option = (arg.spec.async ? "async"
+                            : arg.spec.collect ? "collect"
+                            : arg.spec.explain ? "explain"
+                            : arg.spec.locate != locate_none ? "locate"
+                            : nullptr);
+      if (option)
+        error_with_id ("Octave:invalid-input-arg",
+                       "validateattributes_schema: \"%s\" is not "
+                       "supported", option);
 
-%!test validateattributes (rand (5), {"numeric"}, {});
-%!test validateattributes (rand (5), {"float"}, {});
-%!test validateattributes (rand (5), {"double"}, {});
-%!test validateattributes ("text", {"char"}, {});
-%!test validateattributes (rand (5), {}, {"2d"});
-%!test validateattributes (rand (5), {}, {"3d"});
-%!test validateattributes (rand (5, 5, 5), {}, {"3d"});
-%!test validateattributes (rand (5, 1), {}, {"column"});
-%!test validateattributes (rand (1, 5), {}, {"row"});
-%!test validateattributes ("a", {}, {"scalar"});
-%!test validateattributes (5, {}, {"scalar"});
-%!test validateattributes (rand (1, 5), {}, {"vector"});
-%!test validateattributes (rand (5, 1), {}, {"vector"});
-%!test validateattributes (rand (5), {}, {"square"});
-%!test validateattributes (rand (5), {}, {"nonempty"});
-%!test validateattributes (rand (5), {}, {"nonsparse"});
-%!test validateattributes ([0 1 0 1 0], {}, {"binary"});
-%!test validateattributes (rand (5) > 0.5, {}, {"binary"});
-%!test validateattributes ([8 4 0 6], {}, {"even"});
-%!test validateattributes ([-1 3 5], {}, {"odd"});
-%!test validateattributes ([8 4 0 6], {}, {"real"});
-%!test validateattributes ([8 4i 0 6], {}, {"finite"});
-%!test validateattributes (uint8 ([8 4]), {}, {"finite"});
-%!test validateattributes ([8 Inf], {}, {"nonnan"});
-%!test validateattributes ([0 7 4], {}, {"nonnegative"});
-%!test validateattributes ([-8 7 4], {}, {"nonzero"});
-%!test validateattributes ([8 7 4], {}, {"positive"});
-%!test validateattributes ([8 7 4 -5], {}, {"decreasing"});
-%!test validateattributes ([-8 -7 4 5], {}, {"increasing"});
-%!test validateattributes ([8 4 4 -5], {}, {"nonincreasing"});
-%!test validateattributes ([-8 -8 4 5], {}, {"nondecreasing"});
-%!test validateattributes (rand (4, 6, 7, 2), {}, {"size", [4 6 7 2]});
-%!test validateattributes (rand (4, 6, 7, 2), {}, {"size", [4 NaN 7 2]});
-%!test validateattributes (rand (4, 6, 7, 2), {}, {"size", [4 6 NaN 2 NaN]});
-%!test validateattributes (rand (6, 2), {}, {"numel", 12});
-%!test validateattributes (rand (6, 2), {}, {"ncols", 2});
-%!test validateattributes (rand (6, 2), {}, {"nrows", 6});
-%!test validateattributes (rand (6, 2, 4, 5), {}, {"ndims", 4});
-%!test validateattributes ([4 5 6 7], {}, {">", 3});
-%!test validateattributes ([4 5 6 7], {}, {">=", 4});
-%!test validateattributes ([4 5 6 7], {}, {"<", 8});
-%!test validateattributes ([4 5 6 7], {}, {"<=", 7});
-%!test validateattributes (eye (3), {}, {"diag"});
-%!test validateattributes ([1 0 0; 0 1 0; 0 0 1], {}, {"diag"});
-%!test validateattributes (zeros (3), {}, {"diag"});
-%!test validateattributes ([0 1 0 1], {"double", "uint8"}, {"binary", "size", [NaN 4], "nonnan"});
+      if (arg.kind == schema_parameter)
+        {
+          schema->params.push_back (schema->args.size ());
+          param_names.resize1 (param_names.numel () + 1, arg.name);
+        }
 
-%!test
-%! try validateattributes (ones(1,2,3), {"numeric"}, {"2d"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-2d");
-%! end_try_catch
+      schema->args.push_back (arg);
+    }
 
-%!test
-%! try validateattributes (ones(1,2,3,4), {"numeric"}, {"3d"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-3d");
-%! end_try_catch
+  // references may be to later arguments
+  for (schema_arg& arg : schema->args)
+    for (const attr_op& op : arg.spec.refs)
+      arg.refs.push_back (resolve_ref (*schema, arg.name, op));
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"column"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-column");
-%! end_try_catch
+  schema->param_names = make_string_trie (param_names);
 
-%!test
-%! try validateattributes ([1 2].', {"numeric"}, {"row"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-row");
-%! end_try_catch
+  arg_schemas[++arg_schema_last_token] = std::move (schema);
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"scalar"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-scalar");
-%! end_try_catch
+  return octave_value_list (octave_value (arg_schema_last_token));
+}
 
+/*
 %!test
-%! try validateattributes (ones(3), {"numeric"}, {"vector"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-vector");
-%! end_try_catch
+%! s1 = validateattributes_schema ("f", cell (0, 5));
+%! s2 = validateattributes_schema ("f", cell (0, 5));
+%! assert (s1 != s2);
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"size", [1 1]});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:incorrect-size");
-%! end_try_catch
+%!error <Invalid call> validateattributes_schema ("f")
+%!error <DEFS must be a cell array with 5 columns> validateattributes_schema ("f", {"required", "x"})
+%!error <unknown kind "positional"> validateattributes_schema ("f", {"positional", "x", [], {}, {}})
+%!error <"required" argument 2 after one of kind "optional"> validateattributes_schema ("f", {"optional", "x", 1, {}, {}; "required", "y", [], {}, {}})
+%!error <duplicate name "x"> validateattributes_schema ("f", {"required", "x", [], {}, {}; "parameter", "x", 1, {}, {}})
+%!error <invalid name "1x"> validateattributes_schema ("f", {"required", "1x", [], {}, {}})
+%!error <unknown attribute> validateattributes_schema ("f", {"required", "x", [], {}, {"bogus"}})
+%!error <"async" is not supported> validateattributes_schema ("f", {"required", "x", [], {}, {"async"}})
+%!error <"locate" is not supported> validateattributes_schema ("f", {"required", "x", [], {}, {"locate", "mask"}})
+%!error <"collect" is not supported> validateattributes_schema ("f", {"required", "x", [], {}, {"collect"}})
+%!error <"explain" is not supported> validateattributes_schema ("f", {"optional", "x", 1, {}, {"explain"}})
+%!error <sizeas of "x" refers to an unknown argument> validateattributes_schema ("f", {"required", "x", [], {}, {"sizeas", "y"}})
+%!error <classas of "x" refers to an unknown argument> validateattributes_schema ("f", {"required", "x", [], {}, {"classas", 2}})
+%!error <nrows of "x" must be "numel", "ncols", "nrows", or "ndims" of an argument> validateattributes_schema ("f", {"required", "x", [], {}, {"nrows", "x"}})
+%!error <numel of "x" refers to an unknown argument> validateattributes_schema ("f", {"required", "x", [], {}, {"numel", "ncols(2)"}})
+%!error <sizeas refers to another argument> validateattributes (1, {}, {"sizeas", 2})
+%!error <nrows refers to another argument> validateattributes (1, {}, {"nrows", "ncols(1)"})
+*/
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"numel", 7});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:incorrect-numel");
-%! end_try_catch
+// PKG_ADD: autoload ("validateattributes_parse", "validateattributes.oct");
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"ncols", 7});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:incorrect-numcols");
-%! end_try_catch
+DEFMETHOD_DLD (validateattributes_parse, interp, args, nargout,
+               "-*- texinfo -*-\n\
+@deftypefn  {} {@var{opts} =} validateattributes_parse (@var{schema}, @var{arg1}, @dots{})\n\
+@deftypefnx {} {[@var{opts}, @var{defaulted}] =} validateattributes_parse (@dots{})\n\
+Match and check the arguments of a function against @var{schema}.\n\
+\n\
+@var{schema} comes from @code{validateattributes_schema}.  The arguments\n\
+are matched against it in order: first the required ones, then the\n\
+optional ones until the first string that names a parameter, then\n\
+name/value pairs.  A parameter given more than once takes its last value.\n\
+Each value is checked as by @code{validateattributes}, with the argument's\n\
+name in the error messages.\n\
+\n\
+@var{opts} is a struct with a field for each argument of @var{schema}, set\n\
+to its value or to its default value.  The optional output\n\
+@var{defaulted} is a cell array with the names of the arguments that were\n\
+set to their default values.\n\
+@seealso{validateattributes_schema, validateattributes, inputParser}\n\
+@end deftypefn ")
+{
+  octave_idx_type nargin = args.length ();
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"nrows", 7});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:incorrect-numrows");
-%! end_try_catch
+  if (nargin < 1)
+    print_usage ();
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"ndims", 5});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:incorrect-numdims");
-%! end_try_catch
+  auto it = arg_schemas.find (args(0).xdouble_value ("validateattributes_parse"
+                                                     ": SCHEMA must be a "
+                                                     "number"));
+  if (it == arg_schemas.end ())
+    error_with_id ("Octave:invalid-input-arg",
+                   "validateattributes_parse: unknown SCHEMA %s",
+                   fmt_value (args(0).double_value ()).c_str ());
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"square"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-square");
-%! end_try_catch
+  const arg_schema& schema = *it->second;
+  std::string       err_ini = schema_err_ini (schema);
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"diag"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-diag");
-%! end_try_catch
+  octave::profiler& prof = interp.get_profiler ();
 
-%!test
-%! try validateattributes ([], {"numeric"}, {"nonempty"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nonempty");
-%! end_try_catch
+  std::vector<octave_value> vals (schema.args.size ());
 
-%!test
-%! try validateattributes (speye(2), {"numeric"}, {"nonsparse"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nonsparse");
-%! end_try_catch
+  octave_idx_type k = 1;
+  std::size_t     i = 0;
 
-%!test
-%! try validateattributes (1, {"numeric"}, {">", 3});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-greater");
-%! end_try_catch
+  // positional arguments
+  for ( ; i < schema.args.size () && schema.args[i].kind != schema_parameter;
+       i++)
+    {
+      const schema_arg& arg = schema.args[i];
 
-%!test
-%! try validateattributes (1, {"numeric"}, {">=", 3});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-greater-equal");
-%! end_try_catch
+      if (k == nargin)
+        {
+          if (arg.kind == schema_required)
+            error_with_id ("Octave:invalid-fun-call",
+                           "%s: not enough input arguments",
+                           err_ini.c_str ());
+          break;
+        }
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"<", -3});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-less");
-%! end_try_catch
+      if (arg.kind == schema_optional && args(k).is_string ())
+        {
+          // the start of the name/value pairs
+          std::string name = args(k).string_value ();
+          const string_trie& names = *schema.param_names;
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"<=", -3});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-less-equal");
-%! end_try_catch
+          int n = 0;
+          for (std::size_t c = 0; c < name.length () && n >= 0; c++)
+            n = trie_next (names, n,
+                           std::tolower (static_cast<unsigned char> (name[c])));
 
-%!test
-%! try validateattributes (3, {"numeric"}, {"binary"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-binary");
-%! end_try_catch
+          if (n > 0 && names.nodes[n].unique)
+            break;
+        }
 
-%!test
-%! try validateattributes (1, {"numeric"}, {"even"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-even");
-%! end_try_catch
+      chk_schema_arg (schema, arg, args(k), prof);
+      vals[i] = args(k++);
+    }
 
-%!test
-%! try validateattributes (2, {"numeric"}, {"odd"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-odd");
-%! end_try_catch
+  // name/value pairs
+  for ( ; k < nargin; k += 2)
+    {
+      if (! args(k).is_string ())
+        {
+          if (schema.params.empty ())
+            error_with_id ("Octave:invalid-fun-call",
+                           "%s: too many input arguments", err_ini.c_str ());
+          error_with_id ("Octave:invalid-input-arg",
+                         "%s: expected a parameter name for argument %ld",
+                         err_ini.c_str (), static_cast<long> (k));
+        }
 
-%!test
-%! try validateattributes (1.1, {"numeric"}, {"integer"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-integer");
-%! end_try_catch
+      std::string name = args(k).string_value ();
+      const string_trie& names = *schema.param_names;
 
-%!test
-%! try validateattributes (1+1i*2, {"numeric"}, {"real"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-real");
-%! end_try_catch
+      int n = 0;
+      for (std::size_t c = 0; c < name.length () && n >= 0; c++)
+        n = trie_next (names, n,
+                       std::tolower (static_cast<unsigned char> (name[c])));
 
-%!test
-%! try validateattributes (Inf, {"numeric"}, {"finite"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-finite");
-%! end_try_catch
+      if (n <= 0)
+        error_with_id ("Octave:invalid-input-arg",
+                       "%s: argument '%s' is not a valid parameter",
+                       err_ini.c_str (), name.c_str ());
+      else if (! names.nodes[n].unique)
+        error_with_id ("Octave:invalid-input-arg",
+                       "%s: parameter '%s' is ambiguous:\n%s",
+                       err_ini.c_str (), name.c_str (),
+                       string_matches (names, name).c_str ());
+      else if (k + 1 == nargin)
+        error_with_id ("Octave:invalid-input-arg",
+                       "%s: no value for parameter '%s'", err_ini.c_str (),
+                       name.c_str ());
 
-%!test
-%! try validateattributes (NaN, {"numeric"}, {"nonnan"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nonnan");
-%! end_try_catch
+      std::size_t p = schema.params[names.nodes[n].shortest];
 
-%!test
-%! try validateattributes (-1, {"numeric"}, {"nonnegative"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nonnegative");
-%! end_try_catch
+      chk_schema_arg (schema, schema.args[p], args(k+1), prof);
+      vals[p] = args(k+1);
+    }
 
-%!test
-%! try validateattributes (0, {"numeric"}, {"nonzero"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nonzero");
-%! end_try_catch
+  if (validation_level != level_off)
+    for (i = 0; i < schema.args.size (); i++)
+      if (vals[i].is_defined () && ! schema.args[i].refs.empty ())
+        chk_schema_refs (schema, i, vals);
 
-%!test
-%! try validateattributes (-1, {"numeric"}, {"positive"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-positive");
-%! end_try_catch
+  octave_scalar_map         opts;
+  std::vector<octave_value> defaulted;
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"decreasing"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-decreasing");
-%! end_try_catch
+  for (i = 0; i < schema.args.size (); i++)
+    {
+      const schema_arg& arg = schema.args[i];
 
-%!test
-%! try validateattributes ([2 1], {"numeric"}, {"increasing"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-increasing");
-%! end_try_catch
+      if (vals[i].is_defined ())
+        opts.assign (arg.name, vals[i]);
+      else
+        {
+          opts.assign (arg.name, arg.def);
+          defaulted.push_back (octave_value (arg.name));
+        }
+    }
 
-%!test
-%! try validateattributes ([1 0], {"numeric"}, {"nondecreasing"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nondecreasing");
-%! end_try_catch
+  octave_value_list retval (nargout > 1 ? 2 : 1);
+  retval(0) = opts;
+  if (nargout > 1)
+    {
+      Cell names (dim_vector (1, defaulted.size ()));
+      std::copy (defaulted.begin (), defaulted.end (), names.fortran_vec ());
+      retval(1) = names;
+    }
 
-%!test
-%! try validateattributes ([1 2], {"numeric"}, {"nonincreasing"});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:expected-nonincreasing");
-%! end_try_catch
+  return retval;
+}
+
+/*
+%!shared schema
+%! schema = validateattributes_schema ("myfun", {
+%!   "required",  "x",         [],   {"numeric"}, {"vector"};
+%!   "optional",  "n",         10,   {"numeric"}, {"scalar", "positive"};
+%!   "parameter", "Tolerance", 1e-6, {"double"},  {"scalar", ">", 0};
+%!   "parameter", "Method",    "a",  {"char"},    {}});
 
 %!test
-%! try validateattributes (@sin, {"numeric"}, {});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:invalid-type");
-%! end_try_catch
+%! opts = validateattributes_parse (schema, [1 2 3]);
+%! assert (opts, struct ("x", [1 2 3], "n", 10, "Tolerance", 1e-6,
+%!                       "Method", "a"));
+%!test
+%! [opts, defaulted] = validateattributes_parse (schema, 1, 5, "tol", 0.1);
+%! assert ([opts.n, opts.Tolerance], [5 0.1]);
+%! assert (defaulted, {"Method"});
+%!test
+%! opts = validateattributes_parse (schema, 1, "method", "b", "Method", "c");
+%! assert (opts.n, 10);
+%! assert (opts.Method, "c");
+
+%!error <myfun: not enough input arguments> validateattributes_parse (schema)
+%!error <myfun: x must be of class:> validateattributes_parse (schema, "abc")
+%!error <myfun: n must be positive> validateattributes_parse (schema, 1, -1)
+%!error <myfun: Tolerance must be greater than 0> validateattributes_parse (schema, 1, "Tol", 0)
+%!error <argument 'Bogus' is not a valid parameter> validateattributes_parse (schema, 1, 2, "Bogus", 1)
+%!error <no value for parameter 'Method'> validateattributes_parse (schema, 1, 2, "Method")
+%!error <expected a parameter name for argument 3> validateattributes_parse (schema, 1, 2, 3)
+%!error <unknown SCHEMA> validateattributes_parse (-1)
+
+## arguments compared with each other
+%!shared fit
+%! fit = validateattributes_schema ("fit", {
+%!   "required",  "X", [], {"numeric"}, {"2d"};
+%!   "required",  "y", [], {"numeric"}, {"column", "nrows", "nrows(X)",
+%!                                       "classas", "X"};
+%!   "optional",  "w", [], {"numeric"}, {"sizeas", 2};
+%!   "parameter", "b", [], {},          {"numel", "ncols(1)"}});
 
 %!test
-%! try validateattributes (@sin, 1, {});
-%! catch id,
-%! assert (getfield (id, "identifier"), "Octave:invalid-type");
-%! end_try_catch
+%! validateattributes_parse (fit, ones (3, 2), [1; 2; 3]);
+%! validateattributes_parse (fit, ones (3, 2), [1; 2; 3], [1; 1; 1], "b", [0 0]);
+%! old = validateattributes ("level", "off");
+%! unwind_protect
+%!   validateattributes_parse (fit, ones (3, 2), [1; 2]);
+%! unwind_protect_cleanup
+%!   validateattributes ("level", old);
+%! end_unwind_protect
+%!test
+%! s = validateattributes_schema ("g", {"required", "a", [], {}, {"sizeas", "b"};
+%!                                      "optional", "b", zeros (2), {}, {}});
+%! validateattributes_parse (s, ones (2));
+%! fail ("validateattributes_parse (s, ones (2), 1)",
+%!       "g: a must be of size 1x1 like b but was 2x2");
+
+%!error <fit: y must have 3 rows, the number of rows of X$> validateattributes_parse (fit, ones (3, 2), [1; 2])
+%!error <fit: y must be of class double like X but was single$> validateattributes_parse (fit, ones (3, 2), single ([1; 2; 3]))
+%!error <fit: w must be of size 3x1 like y but was 1x3$> validateattributes_parse (fit, ones (3, 2), [1; 2; 3], [1 1 1])
+%!error <fit: b must have 2 elements, the number of columns of X$> validateattributes_parse (fit, ones (3, 2), [1; 2; 3], "b", 1)
 */